@@ -0,0 +1,351 @@
+#ifndef SRC_ANALYSIS_STATE_H_
+#define SRC_ANALYSIS_STATE_H_
+
+#include <stdint.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "analyzer.h"
+
+/* Analysis saved by --state=FILE with its TraceGraph and hints, so that a later run with edited --hints
+ * reanalyzes only what the edits affect, see Analyzer::reanalyze. A state holds for the object bytes and
+ * analysis options it was saved with, other ones analyze from scratch. With its FunctionTable, it is also
+ * the --baseline of the analysis of a later build with the same options.
+ */
+class AnalysisState {
+	enum {
+		VERSION = 3,
+		BYTES_OFFSET = 12,	// of the hash and size of the object bytes in the header
+		BYTES_SIZE = sizeof(uint64_t) + sizeof(uint32_t)
+	};
+
+	std::vector<uint8_t> buffer;
+	size_t pos;
+
+	template<typename T>
+	void put(T value) {
+		size_t at = buffer.size();
+		buffer.resize(at + sizeof(T));
+		write_le<T>(&buffer[at], value);
+	}
+
+	template<typename T>
+	T get(void) {
+		if (buffer.size() - pos < sizeof(T)) {
+			throw Error() << "Truncated state file";
+		}
+		T value = read_le<T>(&buffer[pos]);
+		pos += sizeof(T);
+		return value;
+	}
+
+	/* What the analysis depends on besides hints */
+	void putHeader(const Analyzer &anal) {
+		buffer.insert(buffer.end(), magic(), magic() + 8);
+		put<uint32_t>(VERSION);
+		uint64_t hash = 14695981039346656037ULL;
+		uint32_t size = 0;
+		for (size_t n = 0; n < anal.image.objects.size(); ++n) {
+			const std::vector<uint8_t> &data = anal.image.objects[n].data;
+			hash = data.empty() ? hash : FunctionTable::hash(&data.front(), data.size(), NULL, 0, hash);
+			size += data.size();
+		}
+		put<uint64_t>(hash);
+		put<uint32_t>(size);
+		put<uint8_t>(anal.superset);
+		put<uint32_t>(NULL != anal.entropy ? (uint32_t) (anal.entropy->low * 1000) : UINT32_MAX);
+		put<uint32_t>(NULL != anal.entropy ? (uint32_t) (anal.entropy->high * 1000) : UINT32_MAX);
+	}
+
+	static const char *magic(void) {
+		return "LESTATE\n";
+	}
+
+	/* Whether the header read matches expected, but for the object bytes unless sameBytes */
+	bool matchesHeader(const AnalysisState &expected, bool sameBytes) const {
+		size_t size = expected.buffer.size();
+		if (buffer.size() < size) {
+			return false;
+		} else if (sameBytes) {
+			return memcmp(&buffer.front(), &expected.buffer.front(), size) == 0;
+		}
+		size_t options = BYTES_OFFSET + BYTES_SIZE;
+		return memcmp(&buffer.front(), &expected.buffer.front(), BYTES_OFFSET) == 0
+				&& memcmp(&buffer[options], &expected.buffer[options], size - options) == 0;
+	}
+
+	bool read(const char *path) {
+		std::ifstream is(path, std::ios::binary);
+		if (!is.is_open()) {
+			return false;
+		}
+		is.seekg(0, std::ios::end);
+		buffer.resize(is.tellg());
+		is.seekg(0, std::ios::beg);
+		if (!buffer.empty()) {
+			is.read((char *) &buffer.front(), buffer.size());
+		}
+		return is.good();
+	}
+
+	void getRegion(Region &reg) {
+		reg.address = get<uint32_t>();
+		reg.size = get<uint32_t>();
+		reg.type = (Type) get<uint8_t>();
+	}
+
+	void getTrace(uint32_t &start, TraceGraph::Trace &trace) {
+		start = get<uint32_t>();
+		trace.end = get<uint32_t>();
+		trace.type = get<uint8_t>();
+		trace.cut = get<uint8_t>() != 0;
+	}
+
+	void getEdges(std::vector<TraceGraph::Edge> &edges) {
+		edges.resize(count(2 * sizeof(uint32_t) + sizeof(uint8_t)));
+		for (size_t n = 0; n < edges.size(); ++n) {
+			edges[n].source = get<uint32_t>();
+			edges[n].target = get<uint32_t>();
+			edges[n].type = get<uint8_t>();
+		}
+	}
+
+	/* Count of the records of recordSize bytes that follow, checked against what is left before anything
+	 * is allocated for them
+	 */
+	uint32_t count(size_t recordSize) {
+		uint32_t count = get<uint32_t>();
+		if ((buffer.size() - pos) / recordSize < count) {
+			throw Error() << "Truncated state file";
+		}
+		return count;
+	}
+
+	void skip(size_t recordSize) {
+		pos += count(recordSize) * recordSize;
+	}
+
+	void putFunctions(const FunctionTable &table) {
+		put<uint32_t>(table.entry);
+		put<uint32_t>(table.exports.size());
+		for (size_t n = 0; n < table.exports.size(); ++n) {
+			put<uint32_t>(table.exports[n]);
+		}
+		put<uint32_t>(table.functions.size());
+		for (size_t n = 0; n < table.functions.size(); ++n) {
+			const FunctionTable::Function &fn = table.functions[n];
+			put<uint32_t>(fn.address);
+			put<uint32_t>(fn.size);
+			put<uint64_t>(fn.hash);
+			put<uint64_t>(fn.prefix);
+			put<uint32_t>(fn.count);
+			for (uint32_t ref = fn.first; ref < fn.first + fn.count; ++ref) {
+				put<uint32_t>(table.references[ref].offset);
+				put<uint32_t>(table.references[ref].target);
+				put<uint8_t>(table.references[ref].kind);
+				put<uint8_t>(table.references[ref].type);
+				put<uint8_t>(table.references[ref].island);
+			}
+		}
+	}
+
+	void getFunctions(FunctionTable &table) {
+		table.entry = get<uint32_t>();
+		table.exports.resize(count(sizeof(uint32_t)));
+		for (size_t n = 0; n < table.exports.size(); ++n) {
+			table.exports[n] = get<uint32_t>();
+		}
+		for (uint32_t count = get<uint32_t>(); count > 0; --count) {
+			FunctionTable::Function fn;
+			fn.address = get<uint32_t>();
+			fn.size = get<uint32_t>();
+			fn.hash = get<uint64_t>();
+			fn.prefix = get<uint64_t>();
+			fn.first = table.references.size();
+			fn.count = get<uint32_t>();
+			for (uint32_t n = 0; n < fn.count; ++n) {
+				FunctionTable::Reference ref;
+				ref.offset = get<uint32_t>();
+				ref.target = get<uint32_t>();
+				ref.kind = get<uint8_t>();
+				ref.type = get<uint8_t>();
+				ref.island = get<uint8_t>();
+				table.references.push_back(ref);
+			}
+			table.functions.push_back(fn);
+		}
+	}
+
+	AnalysisState(void) : pos(0) {}
+public:
+	/* Writes a temporary file and renames it over path, so that a crash leaves the previous state */
+	static void save(const char *path, const Analyzer &anal, LinearExecutable &lx, TraceGraph &graph, const Hints &hints) {
+		AnalysisState state;
+		state.putHeader(anal);
+		state.put<uint32_t>(hints.hints.size());
+		for (size_t n = 0; n < hints.hints.size(); ++n) {
+			state.put<uint32_t>(hints.hints[n].address);
+			state.put<uint32_t>(hints.hints[n].size);
+			state.put<uint8_t>(hints.hints[n].kind);
+		}
+		state.put<uint32_t>(anal.regions.regions.size());
+		for (RegionMap::const_iterator itr = anal.regions.regions.begin(); itr != anal.regions.regions.end(); ++itr) {
+			state.put<uint32_t>(itr->second.address);
+			state.put<uint32_t>(itr->second.size);
+			state.put<uint8_t>(itr->second.type);
+		}
+		state.put<uint32_t>(anal.regions.labelTypes.size());
+		for (LabelMap::const_iterator itr = anal.regions.labelTypes.begin(); itr != anal.regions.labelTypes.end(); ++itr) {
+			state.put<uint32_t>(itr->first);
+			state.put<uint8_t>(itr->second);
+		}
+		state.put<uint32_t>(graph.traces.size());
+		for (std::map<uint32_t, TraceGraph::Trace>::const_iterator itr = graph.traces.begin(); itr != graph.traces.end(); ++itr) {
+			state.put<uint32_t>(itr->first);
+			state.put<uint32_t>(itr->second.end);
+			state.put<uint8_t>(itr->second.type);
+			state.put<uint8_t>(itr->second.cut);
+		}
+		graph.seal();
+		state.put<uint32_t>(graph.incoming.size());	// keeps the order of edges to the same target
+		for (size_t n = 0; n < graph.incoming.size(); ++n) {
+			state.put<uint32_t>(graph.incoming[n].source);
+			state.put<uint32_t>(graph.incoming[n].target);
+			state.put<uint8_t>(graph.incoming[n].type);
+		}
+		state.put<uint32_t>(graph.islands.size());
+		for (std::map<uint32_t, uint32_t>::const_iterator itr = graph.islands.begin(); itr != graph.islands.end(); ++itr) {
+			state.put<uint32_t>(itr->first);
+			state.put<uint32_t>(itr->second);
+		}
+		FunctionTable table;
+		table.collect(anal.regions, graph, lx, anal.image);
+		state.put<uint32_t>(graph.displacements.size());
+		for (size_t n = 0; n < graph.displacements.size(); ++n) {
+			state.put<uint32_t>(graph.displacements[n]);
+		}
+		state.putFunctions(table);
+
+		std::string temporary = std::string(path) + ".tmp";
+		std::ofstream os(temporary.c_str(), std::ios::binary | std::ios::trunc);
+		if (!os.write((const char *) &state.buffer.front(), state.buffer.size()) || (os.close(), !os)) {
+			throw Error() << "Cannot write " << temporary;
+		}
+		if (rename(temporary.c_str(), path) != 0) {
+			throw Error() << "Cannot rename " << temporary << " to " << path << ": " << strerror(errno);
+		}
+	}
+
+	/* Fills the fresh anal, graph and the hints it was made with, false if path holds no state for them */
+	static bool load(const char *path, Analyzer &anal, LinearExecutable &lx, TraceGraph &graph, Hints &previous) {
+		AnalysisState state, expected;
+		if (!state.read(path)) {
+			return false;
+		}
+		expected.putHeader(anal);
+		if (!state.matchesHeader(expected, true)) {
+			if (logging(anal.log, LOG_LOADER, LOG_INFO)) {
+				anal.log << "State " << path << " is of other bytes, options or version, analyzing from scratch\n";
+			}
+			return false;
+		}
+		state.pos = expected.buffer.size();
+
+		previous.hints.resize(state.count(2 * sizeof(uint32_t) + sizeof(uint8_t)));
+		for (size_t n = 0; n < previous.hints.size(); ++n) {
+			previous.hints[n].address = state.get<uint32_t>();
+			previous.hints[n].size = state.get<uint32_t>();
+			previous.hints[n].kind = state.get<uint8_t>();
+		}
+		Regions &regions = anal.regions;
+		regions.regions.clear();
+		regions.classified_bytes = 0;
+		for (uint32_t count = state.get<uint32_t>(); count > 0; --count) {
+			Region reg;
+			state.getRegion(reg);
+			regions.regions.insert(regions.regions.end(), std::make_pair(reg.address, reg));
+			const ImageObject *obj = anal.image.findObject(reg.address);
+			if (UNKNOWN != reg.type && NULL != obj && obj->executable) {
+				regions.classified_bytes += reg.size;
+			}
+		}
+		regions.labelTypes.clear();
+		for (uint32_t count = state.get<uint32_t>(); count > 0; --count) {
+			uint32_t address = state.get<uint32_t>();
+			regions.labelTypes.insert(regions.labelTypes.end(), std::make_pair(address, (Type) state.get<uint8_t>()));
+		}
+		for (uint32_t count = state.get<uint32_t>(); count > 0; --count) {
+			uint32_t start;
+			TraceGraph::Trace trace;
+			state.getTrace(start, trace);
+			graph.traces.insert(graph.traces.end(), std::make_pair(start, trace));
+		}
+		state.getEdges(graph.edges);
+		graph.incoming = graph.edges;
+		std::stable_sort(graph.edges.begin(), graph.edges.end(), TraceGraph::Edge::sourceLess);
+		graph.sorted = graph.edges.size();
+		for (uint32_t count = state.get<uint32_t>(); count > 0; --count) {
+			uint32_t address = state.get<uint32_t>();
+			graph.islands.insert(graph.islands.end(), std::make_pair(address, state.get<uint32_t>()));
+		}
+		graph.displacements.resize(state.count(sizeof(uint32_t)));
+		for (size_t n = 0; n < graph.displacements.size(); ++n) {
+			graph.displacements[n] = state.get<uint32_t>();
+		}
+
+		std::vector<uint32_t> unmapped;	// as traceSwitches drops them
+		for (AddressSet::const_iterator itr = lx.fixup_addresses.begin(); itr != lx.fixup_addresses.end(); ++itr) {
+			if (NULL == regions.regionContaining(*itr)) {
+				unmapped.push_back(*itr);
+			}
+		}
+		for (size_t n = 0; n < unmapped.size(); ++n) {
+			lx.fixup_addresses.erase(unmapped[n]);
+		}
+		return true;
+	}
+
+	/* Fills baseline from the state of another build analyzed with the options of anal, false if path holds none */
+	static bool loadBaseline(const char *path, const Analyzer &anal, Baseline &baseline) {
+		AnalysisState state, expected;
+		if (!state.read(path)) {
+			throw Error() << "Error opening file: " << path;
+		}
+		expected.putHeader(anal);
+		if (!state.matchesHeader(expected, false)) {
+			if (logging(anal.log, LOG_LOADER, LOG_WARNING)) {
+				anal.log << "Warning: baseline " << path << " is of other options or version, analyzing without it\n";
+			}
+			return false;
+		}
+		state.pos = expected.buffer.size();
+
+		state.skip(2 * sizeof(uint32_t) + sizeof(uint8_t));	// hints
+		baseline.regions.resize(state.count(2 * sizeof(uint32_t) + sizeof(uint8_t)));
+		for (size_t n = 0; n < baseline.regions.size(); ++n) {
+			state.getRegion(baseline.regions[n]);
+		}
+		baseline.labels.resize(state.count(sizeof(uint32_t) + sizeof(uint8_t)));
+		for (size_t n = 0; n < baseline.labels.size(); ++n) {
+			baseline.labels[n].first = state.get<uint32_t>();
+			baseline.labels[n].second = (Type) state.get<uint8_t>();
+		}
+		baseline.traces.resize(state.count(2 * sizeof(uint32_t) + 2 * sizeof(uint8_t)));
+		for (size_t n = 0; n < baseline.traces.size(); ++n) {
+			state.getTrace(baseline.traces[n].first, baseline.traces[n].second);
+		}
+		state.getEdges(baseline.edges);
+		std::stable_sort(baseline.edges.begin(), baseline.edges.end(), TraceGraph::Edge::sourceLess);
+		state.skip(2 * sizeof(uint32_t));	// islands
+		state.skip(sizeof(uint32_t));	// displacements
+		state.getFunctions(baseline.table);
+		baseline.index();
+		return true;
+	}
+};
+
+#endif /* SRC_ANALYSIS_STATE_H_ */
@@ -9,25 +9,149 @@
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <set>
+#include <sstream>
+#include <string>
 
+#include "baseline.h"
 #include "dis_info.h"
+#include "entropy.h"
+#include "hints.h"
+#include "label_table.h"
 #include "le/image.h"
 #include "le/lin_ex.h"
+#include "progress.h"
 #include "regions.h"
+#include "slice.h"
+#include "stats.h"
+#include "superset.h"
+#include "trace_graph.h"
+
+typedef std::map<uint32_t/*address*/, unsigned/*call depth*/, std::less<uint32_t>, ArenaAllocator<std::pair<const uint32_t, unsigned> > > TraceDepths;
 
 struct Analyzer {
 	Regions regions;
-	std::deque<uint32_t> code_trace_queue;
+	std::deque<uint32_t, ArenaAllocator<uint32_t> > code_trace_queue;
+	uint64_t queue_pushes;
 	Image &image;
 	DisInfo disasm;
+	Stats *stats;	// optional
+	std::ostream &log;
+	Slice slice;
+	TraceDepths trace_depths;	// only with slice enabled
+	unsigned current_depth;
+	Progress *progress;	// optional
+	bool superset;	// superset disassembly of what tracing left UNKNOWN, see traceSuperset
+	const EntropyClassifier *entropy;	// optional, see skipNonCodePages
+	const Hints *hints;	// optional, see applyHints
+	TraceGraph *graph;	// optional, recorded for reanalyze
+	uint32_t trace_source;	// trace or table scheduling addresses, TraceGraph::NONE otherwise
+	Baseline *baseline;	// optional, see carryOver
+	std::vector<std::pair<uint32_t, uint32_t> > *tracedCode;	// optional, CODE traced while set, see traceSliceSwitches
+	std::map<uint32_t/*address*/, std::string/*name*/> symbols;	// names for labels, see loadSymbols and nameSymbol
+	std::set<std::string> symbolNames;	// of symbols
+	LabelTable labels;	// what printing uses, see buildLabelTable
+
+	Analyzer(LinearExecutable &lx, Image &image_, std::ostream &log_ = std::cerr) : regions(lx.objects, log_), code_trace_queue(ArenaAllocator<uint32_t>(&regions.arena)), queue_pushes(0), image(image_), stats(NULL), log(log_), trace_depths(std::less<uint32_t>(), TraceDepths::allocator_type(&regions.arena)), current_depth(0), progress(NULL), superset(false), entropy(NULL), hints(NULL), graph(NULL), trace_source(TraceGraph::NONE), baseline(NULL), tracedCode(NULL) {
+		for (size_t n = 0; n < lx.exports.entries.size(); ++n) {	// --symbols may rename them
+			const EntryTable::Entry &entry = lx.exports.entries[n];
+			if (0 != entry.name) {
+				nameSymbol(entry.address, lx.exports.name(entry));	// e.g. Watcom "W?name$n"
+			}
+		}
+	}
+
+	Stats::Counters counters(const LinearExecutable &lx) const {
+		Stats::Counters now;
+		now.instructions = disasm.decoded;
+		now.splits = regions.splits;
+		now.merges = regions.merges;
+		now.queue_pushes = queue_pushes;
+		now.labels = regions.labelTypes.size();
+		now.fixups = lx.fixupCount();
+		now.allocations = regions.arena.allocations;
+		return now;
+	}
+
+	void beginPhase(const char *name, const LinearExecutable &lx) {
+		if (NULL != stats) {
+			stats->begin(name, counters(lx));
+		}
+		if (NULL != progress) {
+			updateProgress();
+			progress->beginPhase(name);
+		}
+	}
+
+	void updateProgress(void) {
+		progress->executable_bytes = regions.executable_bytes;
+		progress->classified_bytes = regions.classified_bytes;
+		progress->queue_depth = code_trace_queue.size();
+	}
 
-	Analyzer(LinearExecutable &lx, Image &image_) : regions(lx.objects), image(image_) {}
+	/* Once per traced or printed region: reports progress and throws Cancelled when asked to */
+	void pollProgress(void) {
+		if (NULL != progress) {
+			updateProgress();
+			progress->poll();
+		}
+	}
+
+	void endPhase(const LinearExecutable &lx) {
+		if (NULL != stats) {
+			stats->end(counters(lx));
+		}
+	}
+
+	/* Reads "ADDRESS NAME" lines with hex addresses, '#' starts a comment. Names are sanitized for labels. */
+	void loadSymbols(std::istream &is) {
+		std::string line;
+		for (size_t number = 1; std::getline(is, line); ++number) {
+			std::string content = line.substr(0, line.find('#'));
+			std::istringstream iss(content);
+			uint32_t address;
+			std::string name;
+			if (iss >> std::hex >> address >> name) {
+				nameSymbol(address, name);
+			} else if (content.find_first_not_of(" \t\r") != std::string::npos) {
+				if (logging(log, LOG_LOADER, LOG_WARNING)) {
+					log << "Warning: ignoring symbol line " << std::dec << number << ": " << line << '\n';
+				}
+			}
+		}
+	}
+
+	/* Names the label at address, sanitized and kept apart from the names of other labels, see LabelTable::unique */
+	void nameSymbol(uint32_t address, const std::string &name) {
+		std::map<uint32_t, std::string>::iterator old = symbols.find(address);
+		if (symbols.end() != old) {	// renamed by --symbols
+			symbolNames.erase(old->second);
+		}
+		symbols[address] = LabelTable::unique(LabelTable::sanitize(name), address, symbolNames);
+	}
+
+	/* Freezes the labels of the analysis into the table printing uses */
+	void buildLabelTable(const LinearExecutable &lx) {
+		labels.assign(regions.labelTypes, lx.fixup_addresses, symbols);
+	}
 
 	void add_code_trace_address(uint32_t addr, Type onlyFunctionOrJump, uint32_t refAddress = 0) {
+		if (slice.enabled() && !addSliceDepth(addr, current_depth + (FUNCTION == onlyFunctionOrJump && refAddress > 0))) {
+			regions.labelTypes[addr] = onlyFunctionOrJump;	// named, but not traced
+			return;
+		}
 		this->code_trace_queue.push_back(addr);
+		++queue_pushes;
 		regions.labelTypes[addr] = onlyFunctionOrJump;
-		if (refAddress > 0) {
-			printAddress(printAddress(std::cerr, refAddress) << " schedules ", addr) << std::endl;
+		recordEdge(addr, onlyFunctionOrJump);
+		if (refAddress > 0 && logging(log, LOG_TRACE, LOG_DEBUG)) {
+			printAddress(printAddress(log, refAddress) << " schedules ", addr) << '\n';
+		}
+	}
+
+	void recordEdge(uint32_t target, Type type) {
+		if (NULL != graph && TraceGraph::NONE != trace_source) {
+			graph->addEdge(trace_source, target, type);
 		}
 	}
 
@@ -38,13 +162,38 @@ struct Analyzer {
 			address = this->code_trace_queue.front();
 			this->code_trace_queue.pop_front();
 			this->trace_code_at_address(address);
+			pollProgress();
+		}
+	}
+
+	bool addSliceDepth(uint32_t addr, unsigned depth) {
+		if (!slice.contains(addr) || depth > slice.max_depth) {
+			return false;
+		}
+		TraceDepths::iterator itr = trace_depths.find(addr);
+		if (trace_depths.end() == itr) {
+			trace_depths[addr] = depth;
+		} else {
+			itr->second = std::min(itr->second, depth);
 		}
+		return true;
+	}
+
+	/* Call depth of the traced code around address */
+	unsigned sliceDepthAt(uint32_t address) const {
+		TraceDepths::const_iterator itr = trace_depths.upper_bound(address);
+		return trace_depths.begin() == itr ? 0 : (--itr)->second;
 	}
 
 	void trace_code_at_address(uint32_t start_addr) {
+		if (slice.enabled()) {
+			current_depth = sliceDepthAt(start_addr);
+		}
 		Region *reg = regions.regionContaining(start_addr);
 		if (reg == NULL) {
-			printAddress(std::cerr, start_addr, "Warning: Tried to trace code at an unmapped address: 0x") << std::endl;
+			if (logging(log, LOG_TRACE, LOG_WARNING)) {
+				printAddress(log, start_addr, "Warning: Tried to trace code at an unmapped address: 0x") << '\n';
+			}
 			return;
 		}
 
@@ -52,39 +201,154 @@ struct Analyzer {
 		const std::vector<uint8_t> &data = obj.data;
 		if (reg->get_type() == CODE || reg->get_type() == DATA) {/* already traced */
 			if (reg->get_type() == CODE) {
-				std::map<uint32_t, Type>::iterator label = regions.labelTypes.find(start_addr);
+				LabelMap::iterator label = regions.labelTypes.find(start_addr);
 				if (regions.labelTypes.end() != label && label->second == FUNC_GUESS) {
 					Insn inst;
-					disasm.disassemble(start_addr, &data.front() - obj.base_address + start_addr, reg->get_end_address() - start_addr, inst);
+					disasm.disassemble(start_addr, &data.front() - obj.base_address + start_addr, reg->get_end_address() - start_addr, inst, DecodeProfile::FUNC_GUESS);
 					label->second = (strstr(inst.text, "push") == inst.text || (strstr(inst.text, "sub") == inst.text && strstr(inst.text, ",%esp") != NULL)) ? FUNCTION : JUMP;
 				}
 			}
 			return;
 		} else if (regions.labelTypes.end() == regions.labelTypes.find(start_addr)) {
-			printAddress(std::cerr, start_addr, "Warning: Tracing code without label: 0x") << std::endl;
+			if (logging(log, LOG_TRACE, LOG_WARNING)) {
+				printAddress(log, start_addr, "Warning: Tracing code without label: 0x") << '\n';
+			}
 			// FIXME: generate label
 		}
+		if (NULL != baseline && carryOver(start_addr, *reg)) {
+			return;
+		}
 
 		Type type = CODE;
 		uint32_t nopCount = 0;
-		uint32_t addr = traceRegionUntilAnyJump(reg, start_addr, &data.front() - obj.base_address, type, nopCount);
+		uint32_t forcedEnd = NULL != hints ? hints->forcedCodeEnd(start_addr) : 0;
+		bool cut;
+		trace_source = start_addr;
+		uint32_t addr = traceRegionUntilAnyJump(reg, start_addr, &data.front() - obj.base_address, type, nopCount, cut);
 		if (nopCount == (addr - start_addr)) {
 			type = DATA;
 		}
+		if (0 != forcedEnd) {
+			type = CODE;
+		}
 		if (DATA == type) {
-			std::map<uint32_t, Type>::iterator label = regions.labelTypes.find(start_addr);
+			LabelMap::iterator label = regions.labelTypes.find(start_addr);
 			if (regions.labelTypes.end() != label) {
 				label->second = DATA;
 			}
 		}
 		regions.splitInsert(*reg, Region(start_addr, addr - start_addr, type));
+		if (NULL != tracedCode && CODE == type) {
+			tracedCode->push_back(std::make_pair(start_addr, addr));
+		}
+		if (NULL != graph) {
+			graph->addTrace(start_addr, addr, type, cut);
+		}
+		if (addr < forcedEnd) {	// sized force-code hint, traced on past jumps
+			add_code_trace_address(addr, JUMP);
+		}
+		trace_source = TraceGraph::NONE;
+	}
+
+	/* Takes the regions, labels and traces of the baseline function matching the bytes at the function start
+	 * address over, then schedules what it refers to outside of itself. False if none matches in reg.
+	 */
+	bool carryOver(uint32_t address, Region &reg) {
+		LabelMap::const_iterator label = regions.labelTypes.find(address);
+		if (regions.labelTypes.end() == label || (FUNCTION != label->second && FUNC_GUESS != label->second)) {
+			return false;
+		}
+		const ImageObject &obj = image.objectAt(address);
+		int index = baseline->match(obj, address, reg.get_end_address() - address);
+		if (index < 0) {
+			return false;
+		}
+		const FunctionTable::Function &fn = baseline->table.functions[index];
+		uint32_t delta = address - fn.address;
+		baseline->matched[index] = address;
+		std::vector<Region>::const_iterator prev = std::upper_bound(baseline->regions.begin(), baseline->regions.end(), Region(fn.address, 0, UNKNOWN), regionLess);
+		if (baseline->regions.begin() != prev) {
+			--prev;	// the one containing fn.address
+		}
+		for (; baseline->regions.end() != prev && prev->get_address() < fn.end(); ++prev) {
+			uint32_t from = std::max(prev->get_address(), fn.address), to = std::min<size_t>(prev->get_end_address(), fn.end());
+			if (UNKNOWN != prev->get_type()) {
+				regions.splitInsert(*regions.regionContaining(from + delta), Region(from + delta, to - from, prev->get_type()));
+			}
+		}
+		std::vector<std::pair<uint32_t, Type> >::const_iterator old = std::lower_bound(baseline->labels.begin(), baseline->labels.end(), std::make_pair(fn.address, UNKNOWN));
+		for (; baseline->labels.end() != old && old->first < fn.end(); ++old) {
+			regions.labelTypes[old->first + delta] = old->second;
+		}
+		std::vector<uint32_t> current;
+		baseline->targetsOf(fn, obj, address, current);
+		std::map<uint32_t/*baseline*/, uint32_t/*current*/> targets;	// outside of the function
+		for (uint32_t n = 0; n < fn.count; ++n) {
+			const FunctionTable::Reference &ref = baseline->table.references[fn.first + n];
+			uint32_t target = current[n];
+			if (FunctionTable::RELATIVE == ref.kind && NULL != graph) {
+				graph->displacements.push_back(address + ref.offset);
+			}
+			if (ref.target - fn.address < fn.size) {
+				continue;
+			}
+			targets[ref.target] = target;
+			baseline->pair(ref.target, target);
+			if (FunctionTable::RELATIVE == ref.kind) {
+				add_code_trace_address(target, (Type) ref.type);
+			} else if (0 != ref.island) {	// as traceRegionUntilAnyJump splits FPU operands out
+				Region *island = regions.regionContaining(target);
+				if (NULL != island && UNKNOWN == island->get_type() && target + ref.island <= island->get_end_address()) {
+					regions.splitInsert(*island, Region(target, ref.island, DATA));
+					if (NULL != graph) {
+						graph->islands[target] = ref.island;
+					}
+				}
+				regions.labelTypes[target] = DATA;
+			}
+		}
+		if (NULL != graph) {
+			carryTraces(fn, delta, targets);
+		}
+		return true;
+	}
+
+	static bool regionLess(const Region &a, const Region &b) {
+		return a.get_address() < b.get_address();
+	}
+
+	/* The baseline traces in fn and their edges, those leaving fn only to the targets of its references */
+	void carryTraces(const FunctionTable::Function &fn, uint32_t delta, const std::map<uint32_t, uint32_t> &targets) {
+		std::vector<std::pair<uint32_t, TraceGraph::Trace> >::const_iterator trace = std::lower_bound(baseline->traces.begin(), baseline->traces.end(),
+				std::make_pair(fn.address, TraceGraph::Trace()), traceLess);
+		for (; baseline->traces.end() != trace && trace->first < fn.end(); ++trace) {
+			uint32_t end = std::min(trace->second.end, fn.end());
+			graph->addTrace(trace->first + delta, end + delta, (Type) trace->second.type, trace->second.cut || end != trace->second.end);
+			TraceGraph::Edge key = {trace->first, 0, 0};
+			std::pair<std::vector<TraceGraph::Edge>::const_iterator, std::vector<TraceGraph::Edge>::const_iterator> edges
+					= std::equal_range(baseline->edges.begin(), baseline->edges.end(), key, TraceGraph::Edge::sourceLess);
+			for (; edges.first != edges.second; ++edges.first) {
+				std::map<uint32_t, uint32_t>::const_iterator target = targets.find(edges.first->target);
+				if (edges.first->target - fn.address < fn.size) {
+					graph->addEdge(trace->first + delta, edges.first->target + delta, (Type) edges.first->type);
+				} else if (targets.end() != target) {
+					graph->addEdge(trace->first + delta, target->second, (Type) edges.first->type);
+				}
+			}
+		}
+	}
+
+	static bool traceLess(const std::pair<uint32_t, TraceGraph::Trace> &a, const std::pair<uint32_t, TraceGraph::Trace> &b) {
+		return a.first < b.first;
 	}
 
-	size_t traceRegionUntilAnyJump(Region *&tracedReg, uint32_t &startAddress, const void *offset, Type &type, uint32_t &nopCount) {
+	/* cut tells whether the trace ended at the region end instead of at a jump */
+	size_t traceRegionUntilAnyJump(Region *&tracedReg, uint32_t &startAddress, const void *offset, Type &type, uint32_t &nopCount, bool &cut) {
 		uint32_t addr = startAddress;
 		for (Insn inst; addr < tracedReg->get_end_address(); ) {
 			disassemble(addr, tracedReg->get_end_address(), inst, (uint8_t*) offset + addr, type);
 			for (addr += inst.size; Insn::JUMP == inst.type || Insn::RET == inst.type;) {
+				cut = false;
 				return addr;
 			}
 			if (DATA != type) {
@@ -108,33 +372,40 @@ struct Analyzer {
 					if (reg == NULL) {
 						continue;
 					} else if (reg->get_type() == UNKNOWN) {
-						if (strstr(inst.text, "t ") != NULL) {
-							regions.splitInsert(*reg, Region(inst.memoryAddress, 10, DATA));
-						} else if (strstr(inst.text, "l ") != NULL) {
-							regions.splitInsert(*reg, Region(inst.memoryAddress, 8, DATA));
+						uint32_t size = inst.fpuOperandSize();
+						if (0 == size || inst.memoryAddress + size > reg->get_end_address()	// an environment or state, or across regions
+								|| (tracedReg == reg && inst.memoryAddress < addr && inst.memoryAddress + size > startAddress)) {	// or in this trace
+							if (logging(log, LOG_TRACE, LOG_WARNING)) {
+								printAddress(log, addr - inst.size, "Warning: 0x") << ": operand of " << inst.text << " not split out\n";
+							}
 						} else {
-							throw Error() << "0x" << std::hex << addr - inst.size << ": unsupported FPU operand size in " << inst.text;
+							regions.splitInsert(*reg, Region(inst.memoryAddress, size, DATA));
+							if (NULL != graph) {
+								graph->islands[inst.memoryAddress] = size;
+							}
+							if (tracedReg == reg) {	// the trace goes on in the part it started in, up to the operand if that follows
+								tracedReg = regions.regionContaining(startAddress);
+							}
 						}
-						if (tracedReg == reg) {
-							tracedReg = regions.regionContaining(inst.memoryAddress + 10);
-						}
-					} else if (reg->get_type() != DATA) {
-						printAddress(std::cerr, inst.memoryAddress, "Warning: 0x") << " marked as data" << std::endl;
+					} else if (reg->get_type() != DATA && logging(log, LOG_TRACE, LOG_WARNING)) {
+						printAddress(log, inst.memoryAddress, "Warning: 0x") << " marked as data\n";
 					}
 					regions.labelTypes[inst.memoryAddress] = DATA;
+					recordEdge(inst.memoryAddress, DATA);
 				} else if (addr - inst.size == startAddress && strstr(inst.text, "mov    $") == inst.text) {
 					uint32_t dataAddress = strtol(&inst.text[strlen("mov    $")], NULL, 16);
-					if (regions.regionContaining(dataAddress) != NULL) {
-						const ImageObject &obj = image.objectAt(dataAddress);
-						const std::vector<uint8_t> &data = obj.data;
-						if (strncmp("ABNORMAL TERMINATION", (const char *)(&data.front() - obj.base_address + dataAddress), strlen("ABNORMAL TERMINATION")) == 0) {
-							printAddress(printAddress(std::cerr, startAddress) << ": ___abort signature found at ", dataAddress) << std::endl;
-							regions.labelTypes[startAddress] = FUNCTION;	// eases further script-based transformation
+					const ImageObject *obj = image.findObject(dataAddress);
+					if (NULL != obj && dataAddress - obj->base_address + strlen("ABNORMAL TERMINATION") <= obj->data.size()
+							&& strncmp("ABNORMAL TERMINATION", (const char *) obj->get_data_at(dataAddress), strlen("ABNORMAL TERMINATION")) == 0) {
+						if (logging(log, LOG_TRACE, LOG_INFO)) {
+							printAddress(printAddress(log, startAddress) << ": ___abort signature found at ", dataAddress) << '\n';
 						}
+						regions.labelTypes[startAddress] = FUNCTION;	// eases further script-based transformation
 					}
 				}
 			}
 		}
+		cut = true;
 		return addr;
 	}
 
@@ -146,14 +417,21 @@ struct Analyzer {
 			add_code_trace_address(inst.memoryAddress, JUMP, addr);
 		} else if (Insn::CALL == inst.type) {
 			add_code_trace_address(inst.memoryAddress, FUNCTION, addr);
+		} else {
+			return;
+		}
+		const uint8_t *rel32 = (const uint8_t *) data_ptr + inst.size - 4;
+		if (NULL != graph && inst.size >= 5 && inst.memoryAddress == addr + inst.size + read_le<int32_t>(rel32)) {
+			graph->displacements.push_back(addr + inst.size - 4);
 		}
 	}
 
-	size_t addSwitchAddresses(std::map<uint32_t/*offset*/, uint32_t/*address*/> &fixups, size_t size, const uint8_t *data_ptr, uint32_t offset) {
+	/* Schedules the cases of the table at offset, its first dword and every non-zero one after it covered by a fixup */
+	size_t addSwitchAddresses(FixupMap &fixups, size_t size, const uint8_t *data_ptr, uint32_t offset) {
 		size_t count = 0;
 		for (size_t off = 0; off + 4 <= size; off += 4, ++count) {
 			uint32_t addr = read_le<uint32_t>(data_ptr + off);
-			if (addr != 0) {
+			if (addr != 0 || 0 == off) {	// else a zero dword in a table, like a 0.0 FPU constant after one
 				if (fixups.find(offset + off) == fixups.end()) {
 					break;
 				}
@@ -163,55 +441,84 @@ struct Analyzer {
 		return count;
 	}
 
-	void traceRegionSwitches(LinearExecutable &lx, std::map<uint32_t/*offset*/, uint32_t/*address*/> &fixups, Region &reg, uint32_t address) {
-		const ImageObject &obj = image.objectAt(reg.get_address());
-		if (!obj.executable) {
-			return;
-		}
+	/* Probes for a jump table at address of an executable object, inside the UNKNOWN region reg: the dwords up to
+	 * the next fixup target, as long as fixups cover them. Schedules the cases of a table found, also into cases.
+	 */
+	bool probeSwitch(LinearExecutable &lx, Region &reg, uint32_t address, std::set<uint32_t> &cases) {
+		const ImageObject &obj = image.objectAt(address);
 		size_t size = reg.get_end_address() - address;
-		std::set<uint32_t>::iterator iter = lx.fixup_addresses.upper_bound(address);
-		if (lx.fixup_addresses.end() != iter) {
-			size = std::min<size_t>(size, *iter - address);
+		AddressSet::const_iterator next = lx.fixup_addresses.upper_bound(address);
+		if (lx.fixup_addresses.end() != next) {
+			size = std::min<size_t>(size, *next - address);
 		}
-		size_t count = addSwitchAddresses(fixups, size, obj.get_data_at(address), address - obj.base_address);
-		if (count > 0) {
-			regions.splitInsert(reg, Region(address, 4 * count, SWITCH));
-			regions.labelTypes[address] = SWITCH;
-			trace_code();	// TODO: is returning not enough?
+		size_t queued = code_trace_queue.size();
+		trace_source = address;
+		size_t count = addSwitchAddresses(lx.fixups[obj.index], size, obj.get_data_at(address), address - obj.base_address);
+		trace_source = TraceGraph::NONE;
+		if (0 == count) {
+			return false;
 		}
+		insertSwitch(address, 4 * count);
+		cases.insert(code_trace_queue.begin() + queued, code_trace_queue.end());
+		return true;
 	}
 
-	void traceSwitches(LinearExecutable &lx, std::map<uint32_t/*offset*/, uint32_t/*address*/> &fixups) {
-		for (std::map<uint32_t, uint32_t>::const_iterator itr = fixups.begin(); itr != fixups.end(); ++itr) {
-			Region *reg = regions.regionContaining(itr->second);
+	/* Jump tables at fixup targets in [from, to), in address order. Cases scheduled by the tables found are traced
+	 * before a target that is not one of them is probed, so that code they reach, FPU operands included, is never
+	 * taken for a table.
+	 */
+	void traceSwitches(LinearExecutable &lx, uint32_t from = 0, uint32_t to = UINT32_MAX) {
+		std::vector<uint32_t> unmapped;
+		std::set<uint32_t> cases;	// scheduled, not yet traced
+		for (AddressSet::const_iterator itr = lx.fixup_addresses.lower_bound(from); itr != lx.fixup_addresses.end() && *itr < to; ++itr) {
+			Region *reg = regions.regionContaining(*itr);
 			if (reg == NULL) {
-				printAddress(std::cerr, itr->second, "Warning: Removing reloc pointing to unmapped memory at 0x") << std::endl;
-				lx.fixup_addresses.erase(itr->second);
+				if (logging(log, LOG_TRACE, LOG_WARNING)) {
+					printAddress(log, *itr, "Warning: Removing reloc pointing to unmapped memory at 0x") << '\n';
+				}
+				unmapped.push_back(*itr);
 				continue;
-			} else if (reg->get_type() == UNKNOWN) {
-				traceRegionSwitches(lx, fixups, *reg, itr->second);
+			} else if (reg->get_type() != UNKNOWN || cases.count(*itr) > 0 || !image.objectAt(*itr).executable) {
+				continue;	// a case is code once traced
 			}
+			if (!cases.empty()) {
+				trace_code();
+				cases.clear();
+				reg = regions.regionContaining(*itr);
+				if (reg->get_type() != UNKNOWN) {
+					continue;
+				}
+			}
+			probeSwitch(lx, *reg, *itr, cases);
 		}
+		for (size_t n = 0; n < unmapped.size(); ++n) {
+			lx.fixup_addresses.erase(unmapped[n]);
+		}
+		trace_code();
 	}
 
-	void traceSwitches(LinearExecutable &lx) {
-		for (size_t n = 0; n < lx.objects.size(); ++n) {
-			traceSwitches(lx, lx.fixups[n]);
+	void insertSwitch(uint32_t address, uint32_t size) {
+		regions.splitInsert(*regions.regionContaining(address), Region(address, size, SWITCH));
+		regions.labelTypes[address] = SWITCH;
+		if (NULL != graph) {
+			graph->addTrace(address, address + size, SWITCH, false);
 		}
 	}
 
 	void addAddress(size_t &guess_count, uint32_t address) {
 		Type &type = regions.labelTypes[address];
 		if (FUNCTION != type and JUMP != type) {
-			printAddress(std::cerr, address, "Guessing that 0x") << " is a function" << std::endl;
+			if (logging(log, LOG_TRACE, LOG_DEBUG)) {
+				printAddress(log, address, "Guessing that 0x") << " is a function\n";
+			}
 			++guess_count;
 			type = FUNC_GUESS;
 		}
 		add_code_trace_address(address, type);
 	}
 
-	void addAddressesFromUnknownRegions(size_t &guess_count, std::map<uint32_t/*offset*/, uint32_t/*address*/> &fixups) {
-		for (std::map<uint32_t, uint32_t>::const_iterator itr = fixups.begin(); itr != fixups.end(); ++itr) {
+	void addAddressesFromUnknownRegions(size_t &guess_count, FixupMap &fixups) {
+		for (FixupMap::const_iterator itr = fixups.begin(); itr != fixups.end(); ++itr) {
 			Region *reg = regions.regionContaining(itr->second);
 			if (reg == NULL) {
 				continue;
@@ -223,27 +530,557 @@ struct Analyzer {
 		}
 	}
 
+	/* Like addAddressesFromUnknownRegions, for fixup targets in [from, to) */
+	void addRelocTargets(size_t &guess_count, const LinearExecutable &lx, uint32_t from, uint32_t to) {
+		for (AddressSet::const_iterator itr = lx.fixup_addresses.lower_bound(from); lx.fixup_addresses.end() != itr && *itr < to; ++itr) {
+			Region *reg = regions.regionContaining(*itr);
+			if (reg == NULL) {
+				continue;
+			} else if (reg->get_type() == UNKNOWN) {
+				addAddress(guess_count, *itr);
+			} else if (reg->get_type() == DATA) {
+				regions.labelTypes[*itr] = DATA;
+			}
+		}
+	}
+
 	void trace_remaining_relocs(LinearExecutable &lx) {
 		size_t guess_count = 0;
 		for (size_t n = 0; n < image.objects.size(); ++n) {
 			addAddressesFromUnknownRegions(guess_count, lx.fixups[n]);
 		}
-		std::cerr << std::dec << guess_count << " guess(es) to investigate" << std::endl;
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			log << std::dec << guess_count << " guess(es) to investigate\n";
+		}
+	}
+
+	/* Points tracedCode at traced for its lifetime, so that Cancelled or an Error does not leave it dangling */
+	struct TracedCodeScope {
+		TracedCodeScope(Analyzer &anal_, std::vector<std::pair<uint32_t, uint32_t> > &traced) : anal(anal_) {
+			anal.tracedCode = &traced;
+		}
+
+		~TracedCodeScope(void) {
+			anal.tracedCode = NULL;
+		}
+	private:
+		Analyzer &anal;
+	};
+
+	/* Switch tables referenced from traced code or, with a range, any table in the range. Also labels referenced data. */
+	void traceSliceSwitches(LinearExecutable &lx) {
+		std::set<uint32_t> tried;
+		std::vector<std::pair<uint32_t, uint32_t> > scan, traced;	// code to look for references in, and traced by the round
+		for (RegionMap::const_iterator itr = regions.regions.begin(); itr != regions.regions.end(); ++itr) {
+			if (CODE == itr->second.get_type() && slice.overlaps(itr->first, itr->second.get_end_address())) {
+				scan.push_back(std::make_pair(itr->first, itr->second.get_end_address()));
+			}
+		}
+		TracedCodeScope _(*this, traced);
+		std::vector<std::pair<uint32_t/*table*/, uint32_t/*reference*/> > candidates;
+		for (bool first = true; ; first = false, candidates.clear(), scan.swap(traced), traced.clear()) {
+			for (size_t n = 0; n < scan.size(); ++n) {
+				if (!slice.overlaps(scan[n].first, scan[n].second)) {
+					continue;
+				}
+				const ImageObject &obj = image.objectAt(scan[n].first);
+				FixupMap &fixups = lx.fixups[obj.index];
+				FixupMap::const_iterator fixup = fixups.lower_bound(scan[n].first - obj.base_address);
+				for (; fixups.end() != fixup && fixup->first < scan[n].second - obj.base_address; ++fixup) {
+					if (tried.insert(fixup->second).second) {
+						candidates.push_back(std::make_pair(fixup->second, obj.base_address + fixup->first));
+					}
+				}
+			}
+			if (first && slice.hasRange()) {
+				AddressSet::const_iterator itr = lx.fixup_addresses.lower_bound(slice.from);
+				for (; lx.fixup_addresses.end() != itr && *itr < slice.to; ++itr) {
+					if (tried.insert(*itr).second) {
+						candidates.push_back(std::make_pair(*itr, *itr));
+					}
+				}
+			}
+			if (candidates.empty()) {
+				break;
+			}
+			std::set<uint32_t> cases;	// scheduled, not yet traced
+			for (size_t n = 0; n < candidates.size(); ++n) {
+				if (cases.count(candidates[n].first) > 0) {
+					continue;	// code once traced
+				} else if (!cases.empty()) {
+					trace_code();
+					cases.clear();
+				}
+				Region *reg = regions.regionContaining(candidates[n].first);
+				if (NULL != reg && UNKNOWN == reg->get_type() && slice.contains(candidates[n].first) && image.objectAt(candidates[n].first).executable) {
+					current_depth = sliceDepthAt(candidates[n].second);	// of the cases, so set after tracing the pending ones
+					probeSwitch(lx, *reg, candidates[n].first, cases);
+				} else if (NULL != reg && DATA == reg->get_type()) {
+					regions.labelTypes[candidates[n].first] = DATA;
+				}
+			}
+			trace_code();
+		}
+	}
+
+	void reportSkippedPages(uint32_t start, uint32_t end, double min, double max) {
+		if (start != end && logging(log, LOG_TRACE, LOG_INFO)) {
+			FlagsRestorer _(log);
+			printAddress(printAddress(log, start, "Skipped 0x") << "-", end) << " as data, entropy " << std::fixed << std::setprecision(2)
+					<< min << "-" << max << " bits/byte\n";
+		}
+	}
+
+	/* Marks pages of executable objects whose byte entropy is unlike code's as data before tracing, so that
+	 * neither tracing nor guessing decodes them. Pages with the entry point or an exported entry are kept.
+	 * Only pages overlapping within and still UNKNOWN as a whole if given, see reanalyze.
+	 */
+	void skipNonCodePages(LinearExecutable &lx, const AddressRanges *within = NULL) {
+		uint32_t eip = lx.entryPointAddress();
+		size_t skipped = 0;
+		for (size_t oi = 0; oi < image.objects.size(); ++oi) {
+			const ImageObject &obj = image.objects[oi];
+			uint32_t start = obj.base_address, end = obj.base_address;	// of the pages skipped last
+			double min = 8, max = 0;
+			for (size_t off = 0; obj.executable && off < obj.data.size(); off += EntropyClassifier::PAGE_SIZE) {
+				uint32_t address = obj.base_address + off;
+				uint32_t size = std::min<size_t>(EntropyClassifier::PAGE_SIZE, obj.data.size() - off);
+				if (NULL != within && !overlapsAny(*within, address, address + size)) {
+					continue;
+				}
+				double bits = entropy->entropy(&obj.data[off], size);
+				Region *reg = regions.regionContaining(address);
+				if (entropy->isCode(bits) || NULL == reg || UNKNOWN != reg->get_type() || reg->get_end_address() < address + size
+						|| eip - address < size || exportsWithin(lx, address, size)) {
+					continue;
+				}
+				regions.splitInsert(*reg, Region(address, size, DATA));
+				++skipped;
+				if (address != end || start == end) {
+					reportSkippedPages(start, end, min, max);
+					regions.labelTypes[address] = DATA;
+					start = address;
+					min = 8;
+					max = 0;
+				}
+				end = address + size;
+				min = std::min(min, bits);
+				max = std::max(max, bits);
+			}
+			reportSkippedPages(start, end, min, max);
+		}
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			log << std::dec << skipped << " page(s) skipped by entropy\n";
+		}
+	}
+
+	static bool exportsWithin(const LinearExecutable &lx, uint32_t address, uint32_t size) {
+		for (size_t n = 0; n < lx.exports.entries.size(); ++n) {
+			if (lx.exports.entries[n].address - address < size) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* Traces the chains of leftover UNKNOWN executable regions that superset disassembly scores as likely code,
+	 * of those overlapping within only if given
+	 */
+	void traceSuperset(LinearExecutable &lx, const AddressRanges *within = NULL) {
+		std::vector<std::pair<uint32_t/*address*/, uint32_t/*size*/> > unknown;
+		std::vector<bool> afterCode;
+		const Region *prev = NULL;
+		for (RegionMap::const_iterator itr = regions.regions.begin(); itr != regions.regions.end(); prev = &itr->second, ++itr) {
+			const Region &reg = itr->second;
+			const ImageObject *obj = image.findObject(reg.get_address());
+			if (UNKNOWN == reg.get_type() && NULL != obj && obj->executable && (!slice.enabled() || slice.overlaps(reg.get_address(), reg.get_end_address()))
+					&& (NULL == within || overlapsAny(*within, reg.get_address(), reg.get_end_address()))) {
+				unknown.push_back(std::make_pair(reg.get_address(), (uint32_t) reg.get_size()));
+				afterCode.push_back(NULL != prev && CODE == prev->get_type() && prev->get_end_address() == reg.get_address());
+			}
+		}
+		size_t guess_count = 0;
+		SupersetRegion chains;
+		for (size_t n = 0; n < unknown.size(); ++n) {
+			pollProgress();
+			const ImageObject &obj = image.objectAt(unknown[n].first);
+			chains.decode(disasm, unknown[n].first, obj.get_data_at(unknown[n].first), unknown[n].second);
+			chains.score(regions, lx.fixup_addresses, afterCode[n]);
+			for (size_t off = 0; off < chains.size(); ) {
+				if (chains.promotable(off)) {
+					addAddress(guess_count, unknown[n].first + off);
+					off = chains.chainEnd(off);
+				} else {
+					++off;
+				}
+			}
+		}
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			log << std::dec << guess_count << " superset chain(s) of " << unknown.size() << " unknown region(s) to trace\n";
+		}
+		trace_code();
+	}
+
+	/* Entries exported to other modules are roots like the entry point: functions if executable */
+	void add_exported_entries(LinearExecutable &lx) {
+		for (size_t n = 0; n < lx.exports.entries.size(); ++n) {
+			const EntryTable::Entry &entry = lx.exports.entries[n];
+			if (slice.enabled() && !slice.contains(entry.address)) {
+				continue;
+			} else if (lx.objects[entry.object].isExecutable()) {
+				add_code_trace_address(entry.address, FUNCTION);
+			} else {
+				regions.labelTypes[entry.address] = DATA;
+			}
+		}
+	}
+
+	/* Applies the hints overlapping within: data and tables first, then traces forced code and functions,
+	 * so that tracing from elsewhere stops at them instead of decoding through them
+	 */
+	void applyHints(LinearExecutable &lx, const AddressRanges &within) {
+		for (size_t n = 0; n < hints->hints.size(); ++n) {
+			const Hints::Hint &hint = hints->hints[n];
+			const ImageObject &obj = image.objectAt(hint.address);
+			if (!overlapsAny(within, hint.address, hint.end())) {
+				continue;
+			} else if (!obj.executable) {	// all data already
+				if (Hints::FORCE_DATA != hint.kind && logging(log, LOG_TRACE, LOG_WARNING)) {
+					printAddress(log, hint.address, "Warning: ignoring hint in a data object at 0x") << '\n';
+				}
+				continue;
+			} else if (Hints::FUNCTION == hint.kind) {
+				add_code_trace_address(hint.address, FUNCTION);
+				continue;
+			}
+			regions.unclassify(hint.address, hint.end());
+			if (Hints::FORCE_CODE == hint.kind) {
+				add_code_trace_address(hint.address, JUMP);
+			} else if (Hints::FORCE_DATA == hint.kind) {
+				regions.splitInsert(*regions.regionContaining(hint.address), Region(hint.address, hint.size, DATA));
+				regions.labelTypes[hint.address] = DATA;
+			} else {
+				trace_source = hint.address;
+				size_t count = addSwitchAddresses(lx.fixups[obj.index], hint.size, obj.get_data_at(hint.address), hint.address - obj.base_address);
+				trace_source = TraceGraph::NONE;
+				if (count > 0) {
+					insertSwitch(hint.address, 4 * count);
+				} else if (logging(log, LOG_TRACE, LOG_WARNING)) {
+					printAddress(log, hint.address, "Warning: no jump table at the switch hint at 0x") << '\n';
+				}
+			}
+		}
+		trace_code();
+	}
+
+	/* Function and force-data hints win over the label types references gave, so that calls into forced data
+	 * name the data label printed
+	 */
+	void labelHinted(void) {
+		for (size_t n = 0; NULL != hints && n < hints->hints.size(); ++n) {
+			const Hints::Hint &hint = hints->hints[n];
+			if ((Hints::FUNCTION == hint.kind || Hints::FORCE_DATA == hint.kind) && image.objectAt(hint.address).executable) {
+				regions.labelTypes[hint.address] = Hints::FUNCTION == hint.kind ? FUNCTION : DATA;
+			}
+		}
+	}
+
+	void runSlice(LinearExecutable &lx) {
+		beginPhase("trace slice", lx);
+		current_depth = 0;
+		for (size_t n = 0; n < slice.functions.size(); ++n) {
+			if (logging(log, LOG_TRACE, LOG_INFO)) {
+				printAddress(log, slice.functions[n], "Tracing code of the function at 0x") << '\n';
+			}
+			add_code_trace_address(slice.functions[n], FUNCTION);
+		}
+		if (slice.functions.empty()) {
+			if (slice.contains(lx.entryPointAddress())) {
+				add_code_trace_address(lx.entryPointAddress(), FUNCTION);
+			}
+			add_exported_entries(lx);
+		}
+		trace_code();
+
+		beginPhase("trace switches", lx);
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			log << "Tracing slice relocs for switches...\n";
+		}
+		traceSliceSwitches(lx);
+
+		if (slice.functions.empty()) {
+			beginPhase("trace relocs", lx);
+			if (logging(log, LOG_TRACE, LOG_INFO)) {
+				log << "Tracing remaining relocs in the range for functions and data...\n";
+			}
+			current_depth = 0;
+			size_t guess_count = 0;
+			addRelocTargets(guess_count, lx, slice.from, slice.to);
+			if (logging(log, LOG_TRACE, LOG_INFO)) {
+				log << std::dec << guess_count << " guess(es) to investigate\n";
+			}
+			trace_code();
+		}
+		if (superset) {
+			beginPhase("superset", lx);
+			traceSuperset(lx);
+		}
+		labelHinted();
+		endPhase(lx);
+	}
+
+	/* Drops the trace at start and, when that cuts it short no longer, the one before */
+	void dropTrace(uint32_t start, std::set<uint32_t> &dropped, std::vector<uint32_t> &work) {
+		if (graph->traces.end() != graph->traces.find(start) && dropped.insert(start).second) {
+			work.push_back(start);
+		}
+		dropTraceCutAt(start, dropped, work);
+	}
+
+	/* A trace cut short at what gets undone may go on further */
+	void dropTraceCutAt(uint32_t address, std::set<uint32_t> &dropped, std::vector<uint32_t> &work) {
+		std::map<uint32_t, TraceGraph::Trace>::const_iterator itr = graph->traces.lower_bound(address);
+		if (graph->traces.begin() != itr && (--itr)->second.end == address && itr->second.cut && dropped.insert(itr->first).second) {
+			work.push_back(itr->first);
+		}
+	}
+
+	/* Addresses tracing starts from without an edge: the entry point and exported code */
+	std::set<uint32_t> fixedRoots(LinearExecutable &lx) const {
+		std::set<uint32_t> roots;
+		roots.insert(lx.entryPointAddress());
+		for (size_t n = 0; n < lx.exports.entries.size(); ++n) {
+			if (lx.objects[lx.exports.entries[n].object].isExecutable()) {
+				roots.insert(lx.exports.entries[n].address);
+			}
+		}
+		return roots;
+	}
+
+	/* Undone ranges: the changed hints, the traces overlapping them and whatever only those traces scheduled.
+	 * Hints overlapping the ranges are undone as a whole, as reanalyze applies them again.
+	 */
+	AddressRanges invalidate(LinearExecutable &lx, const std::vector<Hints::Hint> &changed) {
+		std::set<uint32_t> dropped, roots = fixedRoots(lx);
+		std::vector<uint32_t> work;
+		AddressRanges ranges;
+		graph->seal();
+		for (std::vector<Hints::Hint> seeds(changed); !seeds.empty(); seeds = hintsPartlyWithin(ranges)) {
+			for (size_t n = 0; n < seeds.size(); ++n) {
+				ranges.push_back(std::make_pair(seeds[n].address, seeds[n].end()));
+				std::map<uint32_t, TraceGraph::Trace>::const_iterator itr = graph->traces.upper_bound(seeds[n].address);
+				if (graph->traces.begin() != itr && (--itr)->second.end <= seeds[n].address) {
+					++itr;
+				}
+				for (; graph->traces.end() != itr && itr->first < seeds[n].end(); ++itr) {
+					dropTrace(itr->first, dropped, work);
+				}
+				dropTraceCutAt(seeds[n].address, dropped, work);
+			}
+			dropScheduledOnlyBy(lx, dropped, work, roots, ranges);
+			mergeRanges(ranges);
+		}
+		graph->remove(dropped);
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			log << std::dec << "Undoing " << dropped.size() << " trace(s) in " << ranges.size() << " range(s)\n";
+		}
+		return ranges;
+	}
+
+	std::vector<Hints::Hint> hintsPartlyWithin(const AddressRanges &ranges) const {
+		std::vector<Hints::Hint> result;
+		for (size_t n = 0; n < hints->hints.size(); ++n) {
+			const Hints::Hint &hint = hints->hints[n];
+			AddressRanges::const_iterator range = std::upper_bound(ranges.begin(), ranges.end(), std::make_pair(hint.address, UINT32_MAX));
+			bool covered = ranges.begin() != range && hint.end() <= (--range)->second;
+			if (!covered && overlapsAny(ranges, hint.address, hint.end())) {
+				result.push_back(hint);
+			}
+		}
+		return result;
+	}
+
+	/* Whether the reloc pass labels address whatever references it, as a fixup target in data */
+	bool relocatedData(const LinearExecutable &lx, uint32_t address) {
+		Region *reg = regions.regionContaining(address);
+		return NULL != reg && DATA == reg->get_type() && lx.fixup_addresses.find(address) != lx.fixup_addresses.end();
+	}
+
+	/* Drops the traces in work, then what they scheduled that nothing else schedules, transitively */
+	void dropScheduledOnlyBy(const LinearExecutable &lx, std::set<uint32_t> &dropped, std::vector<uint32_t> &work, const std::set<uint32_t> &roots, AddressRanges &ranges) {
+		while (!work.empty()) {
+			uint32_t start = work.back();
+			work.pop_back();
+			ranges.push_back(std::make_pair(start, graph->traces[start].end));
+			dropTraceCutAt(start, dropped, work);
+			std::pair<std::vector<TraceGraph::Edge>::const_iterator, std::vector<TraceGraph::Edge>::const_iterator> edges = graph->outgoing(start);
+			for (std::vector<TraceGraph::Edge>::const_iterator edge = edges.first; edge != edges.second; ++edge) {
+				uint32_t target = edge->target;
+				if (NULL != graph->liveEdge(target, dropped) || roots.end() != roots.find(target) || hints->isRoot(target)) {
+					continue;
+				}
+				std::map<uint32_t, uint32_t>::iterator island = graph->islands.find(target);
+				if (graph->islands.end() != island) {
+					ranges.push_back(*island);
+					ranges.back().second += island->first;
+					dropTraceCutAt(target, dropped, work);
+					graph->islands.erase(island);
+				} else if (graph->traces.end() == graph->traces.find(target) && !relocatedData(lx, target)) {
+					regions.labelTypes.erase(target);	// inside code traced from elsewhere
+				}
+				dropTrace(target, dropped, work);
+			}
+		}
 	}
 
 public:
 	void run(LinearExecutable &lx) {
+		if (NULL != entropy) {
+			beginPhase("entropy", lx);
+			skipNonCodePages(lx);
+		}
+		if (NULL != hints) {
+			beginPhase("hints", lx);
+			applyHints(lx, AddressRanges(1, std::make_pair(0u, (uint32_t) UINT32_MAX)));
+		}
+		if (slice.enabled()) {
+			runSlice(lx);
+			return;
+		}
 		uint32_t eip = lx.entryPointAddress();
+		beginPhase("trace entry", lx);
 		add_code_trace_address(eip, FUNCTION);	// TODO: name it "_start"
-		printAddress(std::cerr, eip, "Tracing code directly accessible from the entry point at 0x") << std::endl;
+		add_exported_entries(lx);
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			printAddress(log, eip, "Tracing code directly accessible from the entry point at 0x") << '\n';
+		}
 		trace_code();
 
-		std::cerr << "Tracing text relocs for switches..." << std::endl;
+		beginPhase("trace switches", lx);
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			log << "Tracing text relocs for switches...\n";
+		}
 		traceSwitches(lx);
 
-		std::cerr << "Tracing remaining relocs for functions and data..." << std::endl;
+		beginPhase("trace relocs", lx);
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			log << "Tracing remaining relocs for functions and data...\n";
+		}
 		trace_remaining_relocs(lx);
 		trace_code();
+		if (superset) {
+			beginPhase("superset", lx);
+			traceSuperset(lx);
+		}
+		labelHinted();
+		endPhase(lx);
+	}
+
+	/* Analyzes again what hints changed since the analysis the graph was recorded with, see TraceGraph.
+	 * The undone ranges go through the phases of run in turn, restricted to them.
+	 */
+	void reanalyze(LinearExecutable &lx, const std::vector<Hints::Hint> &changed) {
+		beginPhase("invalidate", lx);
+		for (AddressRanges ranges = invalidate(lx, changed); !ranges.empty(); ) {
+			retrace(lx, ranges);
+			std::vector<Hints::Hint> guesses = guessesCutting(lx, ranges);
+			if (guesses.empty()) {
+				break;
+			}
+			beginPhase("invalidate", lx);
+			ranges = invalidate(lx, guesses);
+		}
+		labelHinted();
+		endPhase(lx);
+	}
+private:
+	/* Guessed traces and tables next to ranges that cut traces in them short. Guessing comes last in a full run,
+	 * which would have traced through them first.
+	 */
+	std::vector<Hints::Hint> guessesCutting(LinearExecutable &lx, const AddressRanges &ranges) {
+		std::set<uint32_t> roots = fixedRoots(lx), none;
+		std::vector<Hints::Hint> guesses;
+		graph->seal();
+		for (size_t n = 0; n < ranges.size(); ++n) {
+			std::map<uint32_t, TraceGraph::Trace>::const_iterator itr = graph->traces.lower_bound(ranges[n].first);
+			for (; graph->traces.end() != itr && itr->first < ranges[n].second; ++itr) {
+				std::map<uint32_t, TraceGraph::Trace>::const_iterator next = graph->traces.find(itr->second.end);
+				if (!itr->second.cut || graph->traces.end() == next || overlapsAny(ranges, next->first, next->second.end)
+						|| NULL != graph->liveEdge(next->first, none) || roots.end() != roots.find(next->first) || hints->isRoot(next->first)) {
+					continue;
+				}
+				Hints::Hint guess = {next->first, next->second.end - next->first, Hints::KINDS};
+				guesses.push_back(guess);
+			}
+		}
+		return guesses;
+	}
+
+	/* Runs the phases of run on the undone ranges */
+	void retrace(LinearExecutable &lx, const AddressRanges &ranges) {
+		std::vector<std::pair<uint32_t, Type> > referenced;
+		for (size_t n = 0; n < ranges.size(); ++n) {
+			const ImageObject *obj = image.findObject(ranges[n].first);
+			if (NULL == obj || !obj->executable) {
+				continue;
+			}
+			LabelMap::iterator label = regions.labelTypes.lower_bound(ranges[n].first);
+			while (regions.labelTypes.end() != label && label->first < ranges[n].second) {
+				const TraceGraph::Edge *edge = graph->liveEdge(label->first, std::set<uint32_t>());
+				if (NULL == edge) {
+					regions.labelTypes.erase(label++);
+					continue;
+				} else if (DATA != edge->type) {
+					referenced.push_back(std::make_pair(label->first, (Type) edge->type));
+				}
+				label->second = (Type) edge->type;
+				++label;
+			}
+			regions.unclassify(ranges[n].first, ranges[n].second);
+		}
+		for (std::map<uint32_t, uint32_t>::const_iterator island = graph->islands.begin(); island != graph->islands.end(); ++island) {
+			Region *reg = regions.regionContaining(island->first);
+			if (overlapsAny(ranges, island->first, island->first + island->second) && NULL != reg && UNKNOWN == reg->get_type()) {
+				regions.splitInsert(*reg, Region(island->first, island->second, DATA));
+			}
+		}
+
+		if (NULL != entropy) {
+			beginPhase("entropy", lx);
+			skipNonCodePages(lx, &ranges);
+		}
+		beginPhase("hints", lx);
+		applyHints(lx, ranges);
+
+		beginPhase("trace entry", lx);
+		std::set<uint32_t> roots = fixedRoots(lx);
+		for (std::set<uint32_t>::const_iterator root = roots.begin(); root != roots.end(); ++root) {
+			if (overlapsAny(ranges, *root, *root + 1)) {
+				add_code_trace_address(*root, FUNCTION);
+			}
+		}
+		for (size_t n = 0; n < referenced.size(); ++n) {	// references traced after the hints had the last word
+			regions.labelTypes[referenced[n].first] = referenced[n].second;
+			code_trace_queue.push_back(referenced[n].first);
+			++queue_pushes;
+		}
+		trace_code();
+
+		beginPhase("trace switches", lx);
+		for (size_t n = 0; n < ranges.size(); ++n) {
+			traceSwitches(lx, ranges[n].first, ranges[n].second);
+		}
+
+		beginPhase("trace relocs", lx);
+		size_t guess_count = 0;
+		for (size_t n = 0; n < ranges.size(); ++n) {
+			addRelocTargets(guess_count, lx, ranges[n].first, ranges[n].second);
+		}
+		trace_code();
+		if (superset) {
+			beginPhase("superset", lx);
+			traceSuperset(lx, &ranges);
+		}
 	}
 };
 
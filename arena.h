@@ -0,0 +1,164 @@
+#ifndef SRC_ARENA_H_
+#define SRC_ARENA_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/* Memory of one analysis: nodes of the region and label maps and chunks of the trace queue are
+ * carved out of large blocks, which are all released together when the analysis goes away.
+ * Freed memory is kept per size for reuse, erased map nodes are recycled by the next insert.
+ * Chunks over 1 KiB, such as the block map of the trace queue, come from malloc and go back to free.
+ */
+class Arena {
+	enum {
+		BLOCK_SIZE = 64 * 1024,
+		ALIGNMENT = 8,
+		SIZE_CLASSES = 128	// up to 1 KiB, bigger chunks are left to malloc
+	};
+
+	struct FreeChunk {
+		FreeChunk *next;
+	};
+
+	std::vector<char *> blocks;
+	char *current, *current_end;
+	FreeChunk *free_chunks[SIZE_CLASSES];
+
+	Arena(const Arena &);
+	Arena &operator=(const Arena &);
+public:
+	/** allocations served, see Stats */
+	uint64_t allocations;
+
+	Arena(void) : current(NULL), current_end(NULL), allocations(0) {
+		std::fill(free_chunks, free_chunks + SIZE_CLASSES, (FreeChunk *) NULL);
+	}
+
+	~Arena(void) {
+		for (size_t n = 0; n < blocks.size(); ++n) {
+			free(blocks[n]);
+		}
+	}
+
+	void *allocate(size_t size) {
+		++allocations;
+		size_t index = sizeClass(size);
+		if (index >= SIZE_CLASSES) {
+			void *ptr = malloc(size);
+			if (NULL == ptr) {
+				throw std::bad_alloc();
+			}
+			return ptr;
+		}
+		if (NULL != free_chunks[index]) {
+			FreeChunk *chunk = free_chunks[index];
+			free_chunks[index] = chunk->next;
+			return chunk;
+		}
+		size = index * ALIGNMENT;
+		if ((size_t) (current_end - current) < size) {
+			current = (char *) newBlock(BLOCK_SIZE);
+			current_end = current + BLOCK_SIZE;
+		}
+		void *ptr = current;
+		current += size;
+		return ptr;
+	}
+
+	void deallocate(void *ptr, size_t size) {
+		size_t index = sizeClass(size);
+		if (index >= SIZE_CLASSES) {
+			free(ptr);
+		} else if (NULL != ptr) {
+			FreeChunk *chunk = (FreeChunk *) ptr;
+			chunk->next = free_chunks[index];
+			free_chunks[index] = chunk;
+		}
+	}
+
+	size_t blockCount(void) const {
+		return blocks.size();
+	}
+private:
+	/* Zero bytes take an ALIGNMENT unit as with malloc, so that every chunk has room for FreeChunk and an address of its own */
+	static size_t sizeClass(size_t size) {
+		return std::max<size_t>(1, (size + ALIGNMENT - 1) / ALIGNMENT);
+	}
+
+	void *newBlock(size_t size) {
+		char *block = (char *) malloc(size);
+		if (NULL == block) {
+			throw std::bad_alloc();
+		}
+		blocks.push_back(block);
+		return block;
+	}
+};
+
+/* Standard allocator on top of an Arena, for std::map and std::deque */
+template<typename T>
+struct ArenaAllocator {
+	typedef T value_type;
+	typedef T *pointer;
+	typedef const T *const_pointer;
+	typedef T &reference;
+	typedef const T &const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U>
+	struct rebind {
+		typedef ArenaAllocator<U> other;
+	};
+
+	Arena *arena;
+
+	explicit ArenaAllocator(Arena *arena_) : arena(arena_) {}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+	pointer address(reference value) const {
+		return &value;
+	}
+
+	const_pointer address(const_reference value) const {
+		return &value;
+	}
+
+	pointer allocate(size_type count, const void * = NULL) {
+		return (pointer) arena->allocate(count * sizeof(T));
+	}
+
+	void deallocate(pointer ptr, size_type count) {
+		arena->deallocate(ptr, count * sizeof(T));
+	}
+
+	size_type max_size(void) const {
+		return size_type(-1) / sizeof(T);
+	}
+
+	void construct(pointer ptr, const T &value) {
+		new (ptr) T(value);
+	}
+
+	void destroy(pointer ptr) {
+		ptr->~T();
+	}
+};
+
+template<typename T, typename U>
+inline bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+	return a.arena == b.arena;
+}
+
+template<typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+	return a.arena != b.arena;
+}
+
+#endif /* SRC_ARENA_H_ */
@@ -0,0 +1,209 @@
+#ifndef SRC_BASELINE_H_
+#define SRC_BASELINE_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "function_table.h"
+#include "log.h"
+
+/* Analysis of a previous build of the same program, read by --baseline from its --state file. While
+ * tracing the build at hand, Analyzer::carryOver takes the regions, labels and traces of a baseline
+ * function over to where the same bytes, fixups aside, start a function, and only traces what it refers to
+ * outside of itself. Tracing then costs about what changed between the builds.
+ *
+ * Candidates are found by the hash of their first FunctionTable::PREFIX bytes, masked as each baseline
+ * function masks them.
+ */
+struct Baseline {
+	FunctionTable table;
+	std::vector<Region> regions;	// by address
+	std::vector<std::pair<uint32_t, Type> > labels;	// by address
+	std::vector<std::pair<uint32_t, TraceGraph::Trace> > traces;	// by start
+	std::vector<TraceGraph::Edge> edges;	// by source
+	std::vector<uint32_t> matched;	// by function, its address in the build at hand, 0 for none
+	std::map<uint32_t/*baseline*/, uint32_t/*current*/> paired;	// functions referred to alike, matching or not
+	const std::vector<FixupMap> &fixups;	// of the build at hand
+
+	Baseline(const std::vector<FixupMap> &fixups_) : fixups(fixups_) {}
+
+	/* Prefix index, once loaded */
+	void index(void) {
+		matched.assign(table.functions.size(), 0);
+		for (size_t n = 0; n < table.functions.size(); ++n) {
+			const FunctionTable::Function &fn = table.functions[n];
+			Key key = {std::min<uint32_t>(FunctionTable::PREFIX, fn.size), 0, fn.prefix, n};
+			for (uint32_t ref = fn.first; ref < fn.first + fn.count && table.references[ref].offset < key.length; ++ref) {
+				uint32_t end = std::min(key.length, table.references[ref].offset + table.references[ref].size());
+				for (uint32_t off = table.references[ref].offset; off < end; ++off) {
+					key.mask |= 1u << off;
+				}
+			}
+			keys.push_back(key);
+		}
+		std::sort(keys.begin(), keys.end());
+		for (size_t n = 0; n < keys.size(); ++n) {
+			if (n == 0 || keys[n].length != keys[n - 1].length || keys[n].mask != keys[n - 1].mask) {
+				patterns.push_back(keys[n]);
+			}
+		}
+	}
+
+	/* Index of an unmatched function, or else any, whose bytes and fixups are those at address, -1 for none */
+	int match(const ImageObject &obj, uint32_t address, uint32_t available) const {
+		const uint8_t *data = obj.get_data_at(address);
+		FixupMap::const_iterator fixup = fixups[obj.index].lower_bound(address - obj.base_address);
+		int found = -1;
+		for (size_t p = 0; p < patterns.size(); ++p) {
+			if (patterns[p].length > available) {
+				continue;
+			}
+			Key key = {patterns[p].length, patterns[p].mask, prefixHash(data, patterns[p].length, patterns[p].mask), 0};
+			std::vector<Key>::const_iterator itr = std::lower_bound(keys.begin(), keys.end(), key);
+			for (; keys.end() != itr && itr->length == key.length && itr->mask == key.mask && itr->hash == key.hash; ++itr) {
+				if (matches(table.functions[itr->function], obj, address, available, fixup)) {
+					if (0 == matched[itr->function]) {
+						return itr->function;
+					}
+					found = itr->function;
+				}
+			}
+		}
+		return found;
+	}
+
+	/* Addresses in the build at hand of what the references of fn, matched at address, refer to */
+	void targetsOf(const FunctionTable::Function &fn, const ImageObject &obj, uint32_t address, std::vector<uint32_t> &targets) const {
+		FixupMap::const_iterator fixup = fixups[obj.index].lower_bound(address - obj.base_address);
+		targets.resize(fn.count);
+		for (uint32_t n = 0; n < fn.count; ++n) {
+			const FunctionTable::Reference &ref = table.references[fn.first + n];
+			uint32_t at = address + ref.offset;
+			if (FunctionTable::RELATIVE == ref.kind) {
+				targets[n] = at + 4 + read_le<int32_t>(obj.get_data_at(at));
+			} else {
+				targets[n] = (fixup++)->second;	// in the same order, see matches
+			}
+		}
+	}
+
+	/* Notes that the baseline function at previous, if any, is at current now */
+	void pair(uint32_t previous, uint32_t current) {
+		std::vector<FunctionTable::Function>::const_iterator fn = findFunction(previous);
+		if (table.functions.end() != fn && fn->address == previous) {
+			paired.insert(std::make_pair(previous, current));
+		}
+	}
+
+	/* Pairs the entry point and exports, logs the counts and writes "changed OLD NEW", "added NEW" and
+	 * "removed OLD" lines to diff if given. Functions are FUNCTION labels of code in both builds.
+	 */
+	void report(Regions &current, LinearExecutable &lx, std::ostream &log, std::ostream *diff) {
+		paired[table.entry] = lx.entryPointAddress();
+		for (size_t n = 0; n < table.exports.size() && n < lx.exports.entries.size(); ++n) {
+			paired[table.exports[n]] = lx.exports.entries[n].address;
+		}
+		std::set<uint32_t> known;	// current addresses of unchanged and changed functions
+		size_t unchanged = 0, changed = 0, added = 0, removed = 0;
+		for (size_t n = 0; n < table.functions.size(); ++n) {
+			uint32_t address = table.functions[n].address;
+			std::map<uint32_t, uint32_t>::const_iterator pair = paired.find(address);
+			if (0 != matched[n]) {
+				known.insert(matched[n]);
+				++unchanged;
+			} else if (paired.end() != pair && isFunction(current, pair->second) && known.insert(pair->second).second) {
+				if (NULL != diff) {
+					printAddress(printAddress(*diff, address, "changed ") << ' ', pair->second, "") << '\n';
+				}
+				++changed;
+			} else {
+				if (NULL != diff) {
+					printAddress(*diff, address, "removed ") << '\n';
+				}
+				++removed;
+			}
+		}
+		for (LabelMap::const_iterator label = current.labelTypes.begin(); label != current.labelTypes.end(); ++label) {
+			if (known.end() == known.find(label->first) && isFunction(current, label->first)) {
+				if (NULL != diff) {
+					printAddress(*diff, label->first, "added ") << '\n';
+				}
+				++added;
+			}
+		}
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			log << std::dec << "Baseline: " << unchanged << " function(s) carried over, " << changed << " changed, "
+					<< added << " added, " << removed << " removed\n";
+		}
+	}
+private:
+	struct Key {
+		uint32_t length;
+		uint32_t mask;	// of the bytes references cover
+		uint64_t hash;
+		size_t function;
+
+		bool operator<(const Key &other) const {
+			if (length != other.length) {
+				return length < other.length;
+			}
+			return mask != other.mask ? mask < other.mask : hash < other.hash;
+		}
+	};
+
+	std::vector<Key> keys;
+	std::vector<Key> patterns;	// distinct lengths and masks of keys
+
+	/* FunctionTable::hash with the bytes of references given by mask */
+	static uint64_t prefixHash(const uint8_t *data, uint32_t length, uint32_t mask) {
+		uint64_t value = 14695981039346656037ULL;
+		for (uint32_t off = 0; off < length; ++off) {
+			value = (value ^ ((mask >> off) & 1 ? 0 : data[off])) * 1099511628211ULL;
+		}
+		return value;
+	}
+
+	std::vector<FunctionTable::Function>::const_iterator findFunction(uint32_t address) const {
+		FunctionTable::Function key = {address, 0, 0, 0, 0, 0};
+		return std::lower_bound(table.functions.begin(), table.functions.end(), key, addressLess);
+	}
+
+	static bool addressLess(const FunctionTable::Function &a, const FunctionTable::Function &b) {
+		return a.address < b.address;
+	}
+
+	/* Whether fn has fixups at the same offsets at address, the first one at or after it given, and hashes alike */
+	bool matches(const FunctionTable::Function &fn, const ImageObject &obj, uint32_t address, uint32_t available, FixupMap::const_iterator fixup) const {
+		const FunctionTable::Reference *refs = table.references.empty() ? NULL : &table.references.front() + fn.first;
+		if (fn.size > available) {
+			return false;
+		}
+		const FixupMap &objectFixups = fixups[obj.index];
+		for (uint32_t n = 0; n < fn.count; ++n) {
+			if (FunctionTable::RELATIVE == refs[n].kind) {
+				continue;
+			} else if (objectFixups.end() == fixup || obj.base_address + fixup->first != address + refs[n].offset
+					|| (fixup->second < 256) != (FunctionTable::SELECTOR == refs[n].kind)) {
+				return false;
+			}
+			++fixup;
+		}
+		if (objectFixups.end() != fixup && obj.base_address + fixup->first + (fixup->second < 256 ? 2 : 4) <= address + fn.size) {
+			return false;	// one more than collected
+		}
+		return FunctionTable::hash(obj.get_data_at(address), fn.size, refs, fn.count) == fn.hash;
+	}
+
+	static bool isFunction(Regions &regions, uint32_t address) {
+		LabelMap::const_iterator label = regions.labelTypes.find(address);
+		const Region *reg = regions.regionContaining(address);
+		return regions.labelTypes.end() != label && FUNCTION == label->second && NULL != reg && CODE == reg->get_type();
+	}
+};
+
+#endif /* SRC_BASELINE_H_ */
@@ -0,0 +1,471 @@
+/* Synthetic linear executable generator for benchmarking le_disasm.
+ *
+ * Code objects get functions with prologue/epilogue, filler instructions, calls, short jumps,
+ * FPU and plain data references and switch tables. Data objects get strings, zeros and
+ * pointers back into code and data. Every absolute address is covered by a fixup record.
+ */
+#include <stdint.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+static const uint32_t PAGE_SIZE = 0x1000;
+static const uint32_t HEADER_OFFSET = 0x80;
+static const uint32_t HEADER_SIZE = 0xb0;
+
+struct Options {
+	uint32_t code_objects;
+	uint32_t data_objects;
+	uint32_t pages;	// per object
+	uint32_t functions;	// per code object, 0 means one per 256 bytes
+	uint32_t call_density;	// percent of body instructions
+	uint32_t jump_density;
+	uint32_t fpu_density;
+	uint32_t data_density;
+	uint32_t switches;	// per code object
+	uint32_t case_constants;	// percent of switches whose cases load an FPU constant kept after them
+	uint32_t pointer_density;	// percent of data chunks
+	uint32_t exports;	// functions in the entry table, all code objects
+	uint32_t checksums;	// non-zero writes page and section checksums
+	uint32_t seed;
+	uint32_t build;	// non-zero seeds functions by index and grows build - 1 of every 100, see generate()
+
+	Options(void) : code_objects(1), data_objects(1), pages(16), functions(0), call_density(8), jump_density(10),
+			fpu_density(3), data_density(6), switches(4), case_constants(0), pointer_density(30), exports(0), checksums(0), seed(1), build(0) {}
+};
+
+struct Object {
+	uint32_t base_address;
+	uint32_t flags;
+	std::vector<uint8_t> data;
+	std::map<uint32_t/*offset*/, uint32_t/*address*/> fixups;
+};
+
+struct Generator {
+	Options opt;
+	std::vector<Object> objects;
+	std::vector<uint32_t> functions;	// addresses, all code objects
+	uint32_t random_state;
+
+	Generator(const Options &opt_) : opt(opt_), random_state(opt_.seed) {}
+
+	uint32_t random(uint32_t limit) {
+		random_state = random_state * 1103515245 + 12345;
+		return limit > 0 ? (random_state >> 8) % limit : 0;
+	}
+
+	static void put32(std::vector<uint8_t> &buf, uint32_t off, uint32_t value) {
+		for (size_t n = 0; n < 4; ++n) {
+			buf[off + n] = value >> (n * 8);
+		}
+	}
+
+	void putAddress(Object &obj, uint32_t off, uint32_t address) {
+		put32(obj.data, off, address);
+		obj.fixups[off] = address;
+	}
+
+	uint32_t dataAddress(uint32_t align) {
+		if (opt.data_objects == 0) {
+			return 0;
+		}
+		const Object &obj = objects[opt.code_objects + random(opt.data_objects)];
+		return obj.base_address + (random(obj.data.size() - 16) & ~(align - 1));
+	}
+
+	size_t emitFiller(std::vector<uint8_t> &buf, uint32_t pos) {
+		static const uint8_t fillers[][3] = {{0x89, 0xc3}, {0x83, 0xc0, 0x10}, {0x31, 0xc0}, {0x8b, 0x45, 0x08}, {0x01, 0xd8}};
+		static const size_t sizes[] = {2, 3, 2, 3, 2};
+		size_t n = random(sizeof(sizes) / sizeof(sizes[0]));
+		memcpy(&buf[pos], fillers[n], sizes[n]);
+		return sizes[n];
+	}
+
+	/* Emits a switch at the end of a function: jmp *table(,%eax,4), the table, then the cases, with
+	 * opt.case_constants each loading a 0.0 double kept after the last case
+	 */
+	uint32_t emitSwitch(Object &obj, uint32_t pos, uint32_t end) {
+		uint32_t cases = 2 + random(14);
+		bool constant = opt.case_constants > 0 && random(100) < opt.case_constants;
+		uint32_t caseSize = constant ? 10 : 4;
+		if (pos + 7 + cases * (4 + caseSize) + (constant ? 8 : 0) + 16 > end) {
+			return pos;
+		}
+		uint32_t table = pos + 7;
+		uint32_t island = table + cases * (4 + caseSize);
+		obj.data[pos] = 0xff;
+		obj.data[pos + 1] = 0x24;
+		obj.data[pos + 2] = 0x85;
+		putAddress(obj, pos + 3, obj.base_address + table);
+		pos = table + cases * 4;
+		for (uint32_t n = 0; n < cases; ++n) {
+			putAddress(obj, table + n * 4, obj.base_address + pos);
+			if (constant) {
+				obj.data[pos] = 0xdd;	// fldl
+				obj.data[pos + 1] = 0x05;
+				putAddress(obj, pos + 2, obj.base_address + island);
+				pos += 6;
+			}
+			static const uint8_t body[] = {0x31, 0xc0, 0x5d, 0xc3};	// xor %eax,%eax; pop %ebp; ret
+			memcpy(&obj.data[pos], body, sizeof(body));
+			pos += sizeof(body);
+		}
+		if (constant) {
+			memset(&obj.data[pos], 0, 8);
+			pos += 8;
+		}
+		return pos;
+	}
+
+	void emitFunction(Object &obj, uint32_t pos, uint32_t end, bool withSwitch) {
+		static const uint8_t prologue[] = {0x55, 0x89, 0xe5};	// push %ebp; mov %esp,%ebp
+		memcpy(&obj.data[pos], prologue, sizeof(prologue));
+		pos += sizeof(prologue);
+		uint32_t bodyEnd = withSwitch ? pos + (end - pos) / 2 : end - 2;
+		while (pos + 8 <= bodyEnd) {
+			uint32_t r = random(100);
+			if (r < opt.call_density) {
+				obj.data[pos] = 0xe8;
+				put32(obj.data, pos + 1, functions[random(functions.size())] - (obj.base_address + pos + 5));
+				pos += 5;
+			} else if ((r -= opt.call_density) < opt.jump_density) {
+				static const uint8_t jump[] = {0x74, 0x02, 0x89, 0xc3};	// je over mov %eax,%ebx
+				memcpy(&obj.data[pos], jump, sizeof(jump));
+				pos += sizeof(jump);
+			} else if ((r -= opt.jump_density) < opt.fpu_density && opt.data_objects > 0) {
+				obj.data[pos] = 0xdd;	// fldl
+				obj.data[pos + 1] = 0x05;
+				putAddress(obj, pos + 2, dataAddress(8));
+				pos += 6;
+			} else if ((r -= opt.fpu_density) < opt.data_density && opt.data_objects > 0) {
+				obj.data[pos] = 0xa1;	// mov addr,%eax
+				putAddress(obj, pos + 1, dataAddress(4));
+				pos += 5;
+			} else {
+				pos += emitFiller(obj.data, pos);
+			}
+		}
+		if (withSwitch && emitSwitch(obj, pos, end) != pos) {
+			return;
+		}
+		obj.data[pos] = 0x5d;	// pop %ebp
+		obj.data[pos + 1] = 0xc3;	// ret
+	}
+
+	void fillData(Object &obj) {
+		for (uint32_t pos = 0; pos + 32 < obj.data.size(); ) {
+			uint32_t r = random(100);
+			if (r < opt.pointer_density && !functions.empty()) {
+				putAddress(obj, pos, random(4) > 0 ? functions[random(functions.size())] : dataAddress(4));
+				pos += 4;
+			} else if (r < opt.pointer_density + 30) {
+				int len = snprintf((char *) &obj.data[pos], 24, "string %u", random(100000));
+				pos += len + 1;
+			} else if (r < opt.pointer_density + 50) {
+				pos += 16;	// zeros
+			} else {
+				for (uint32_t end = pos + 8; pos < end; obj.data[pos++] = 0x80 + random(0x80));
+			}
+		}
+	}
+
+	bool grown(uint32_t f) const {
+		return opt.build > 0 && f % 100 < opt.build - 1;
+	}
+
+	/* Builds differing in opt.build only share the functions neither grows, moved by those grown before them:
+	 * each function gets its own random stream, and a grown one 16 more bytes of body.
+	 */
+	void generate(void) {
+		uint32_t base = 0x10000;
+		objects.resize(opt.code_objects + opt.data_objects);
+		for (size_t oi = 0; oi < objects.size(); ++oi) {
+			objects[oi].base_address = base;
+			objects[oi].flags = oi < opt.code_objects ? 0x2005 : 0x2003;	// 32-bit, readable, executable/writable
+			objects[oi].data.resize(opt.pages * PAGE_SIZE, oi < opt.code_objects ? 0xcc : 0x00);
+			base += (opt.pages * PAGE_SIZE + 0xffff) & ~0xffff;
+		}
+		uint32_t count = opt.functions > 0 ? opt.functions : opt.pages * PAGE_SIZE / 256;
+		uint32_t reserve = opt.build > 0 ? count * 16 : 0;	// for grown functions
+		uint32_t stride = (opt.pages * PAGE_SIZE - 8 - std::min(reserve, opt.pages * PAGE_SIZE - 8)) / count & ~0xf;
+		if (stride < 32) {
+			throw std::runtime_error("too many functions for the object size");
+		}
+		std::vector<uint32_t> starts;	// offsets, the same in all code objects
+		for (uint32_t f = 0, start = 0; f <= count; start += stride + (grown(f) ? 16 : 0), ++f) {
+			starts.push_back(start);
+		}
+		for (size_t oi = 0; oi < opt.code_objects; ++oi) {
+			for (uint32_t f = 0; f < count; ++f) {
+				functions.push_back(objects[oi].base_address + starts[f]);
+			}
+		}
+		for (size_t oi = 0; oi < opt.code_objects; ++oi) {
+			for (uint32_t f = 0; f < count; ++f) {
+				bool withSwitch = opt.switches > 0 && f % std::max<uint32_t>(1, count / opt.switches) == 1;
+				if (opt.build > 0) {
+					random_state = opt.seed ^ ((oi * count + f) * 2654435761u);
+				}
+				emitFunction(objects[oi], starts[f], starts[f + 1], withSwitch);
+			}
+		}
+		if (opt.build > 0) {
+			random_state = opt.seed ^ 0x5bd1e995;
+		}
+		for (size_t oi = opt.code_objects; oi < objects.size(); ++oi) {
+			fillData(objects[oi]);
+		}
+	}
+
+	template<typename T>
+	static void write_le(std::vector<uint8_t> &buf, T value) {
+		for (size_t n = 0; n < sizeof(T); ++n) {
+			buf.push_back((uint8_t) (value >> (n * 8)));
+		}
+	}
+
+	/* Sum of little endian dwords, what le_disasm --verify checks */
+	static uint32_t checksum(const uint8_t *data, size_t size) {
+		uint32_t sum = 0;
+		for (size_t n = 0; n < size; ++n) {
+			sum += (uint32_t) data[n] << (n % 4 * 8);
+		}
+		return sum;
+	}
+
+	static uint32_t checksum(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+		std::vector<uint8_t> joined(a);
+		joined.insert(joined.end(), b.begin(), b.end());
+		return joined.empty() ? 0 : checksum(&joined.front(), joined.size());
+	}
+
+	/* Entry table with a 32-bit bundle per run of exports in the same object, named "export_ORDINAL"
+	 * by the resident name table for odd and by the non-resident one for even ordinals */
+	void writeExports(std::vector<uint8_t> &entryTable, std::vector<uint8_t> &residentNames, std::vector<uint8_t> &nonResidentNames) {
+		std::vector<uint32_t> exports;
+		for (uint32_t n = 0; n < opt.exports && !functions.empty(); ++n) {
+			exports.push_back(functions[(uint64_t) n * functions.size() / opt.exports]);
+		}
+		static const char module[] = "SYNTHETIC";
+		write_le<uint8_t>(residentNames, sizeof(module) - 1);
+		residentNames.insert(residentNames.end(), module, module + sizeof(module) - 1);
+		write_le<uint16_t>(residentNames, 0);
+		for (size_t n = 0; n < exports.size(); ) {
+			size_t object = targetObject(exports[n]);
+			size_t count = 1;
+			while (count < 255 && n + count < exports.size() && targetObject(exports[n + count]) == object) {
+				++count;
+			}
+			write_le<uint8_t>(entryTable, count);
+			write_le<uint8_t>(entryTable, 3);	// 32-bit entries
+			write_le<uint16_t>(entryTable, object + 1);
+			for (size_t end = n + count; n < end; ++n) {
+				write_le<uint8_t>(entryTable, 0x01);	// exported
+				write_le<uint32_t>(entryTable, exports[n] - objects[object].base_address);
+				char name[16];
+				uint32_t length = snprintf(name, sizeof(name), "export_%u", (uint32_t) n + 1);
+				std::vector<uint8_t> &names = n % 2 == 0 ? residentNames : nonResidentNames;
+				write_le<uint8_t>(names, length);
+				names.insert(names.end(), name, name + length);
+				write_le<uint16_t>(names, n + 1);
+			}
+		}
+		write_le<uint8_t>(entryTable, 0);
+		write_le<uint8_t>(residentNames, 0);
+		write_le<uint8_t>(nonResidentNames, 0);
+	}
+
+	void write(std::ostream &os) {
+		std::vector<uint8_t> objectTable, pageTable, fixupPageTable, fixupRecords, entryTable, residentNames, nonResidentNames, pageChecksums;
+		uint32_t pageCount = 0;
+		for (size_t oi = 0; oi < objects.size(); ++oi) {
+			const Object &obj = objects[oi];
+			uint32_t pages = obj.data.size() / PAGE_SIZE;
+			write_le<uint32_t>(objectTable, obj.data.size());
+			write_le<uint32_t>(objectTable, obj.base_address);
+			write_le<uint32_t>(objectTable, obj.flags);
+			write_le<uint32_t>(objectTable, pageCount + 1);
+			write_le<uint32_t>(objectTable, pages);
+			write_le<uint32_t>(objectTable, 0);
+			std::map<uint32_t, uint32_t>::const_iterator fixup = obj.fixups.begin();
+			for (uint32_t page = 0; page < pages; ++page) {
+				uint32_t number = ++pageCount;	// the loader reads it as first + second - 1
+				write_le<uint16_t>(pageTable, number - std::min<uint32_t>(number, 255));
+				write_le<uint8_t>(pageTable, std::min<uint32_t>(number, 255));
+				write_le<uint8_t>(pageTable, 0);
+				write_le<uint32_t>(fixupPageTable, fixupRecords.size());
+				write_le<uint32_t>(pageChecksums, opt.checksums > 0 ? checksum(&obj.data[page * PAGE_SIZE], PAGE_SIZE) : 0);
+				for (; obj.fixups.end() != fixup && fixup->first < (page + 1) * PAGE_SIZE; ++fixup) {
+					size_t target = targetObject(fixup->second);
+					write_le<uint8_t>(fixupRecords, 0x07);	// 32-bit offset
+					write_le<uint8_t>(fixupRecords, 0x10);	// internal reference, 32-bit target offset
+					write_le<int16_t>(fixupRecords, fixup->first - page * PAGE_SIZE);
+					write_le<uint8_t>(fixupRecords, target + 1);
+					write_le<uint32_t>(fixupRecords, fixup->second - objects[target].base_address);
+				}
+			}
+		}
+		write_le<uint32_t>(fixupPageTable, fixupRecords.size());
+		if (opt.exports > 0) {
+			writeExports(entryTable, residentNames, nonResidentNames);
+		}
+
+		uint32_t objectTableOffset = HEADER_SIZE;
+		uint32_t pageTableOffset = objectTableOffset + objectTable.size();
+		uint32_t fixupPageTableOffset = pageTableOffset + pageTable.size();
+		uint32_t fixupRecordTableOffset = fixupPageTableOffset + fixupPageTable.size();
+		uint32_t residentNamesOffset = fixupRecordTableOffset + fixupRecords.size();
+		uint32_t entryTableOffset = residentNamesOffset + residentNames.size();
+		uint32_t pageChecksumsOffset = entryTableOffset + entryTable.size();
+		uint32_t nonResidentNamesOffset = HEADER_OFFSET + pageChecksumsOffset + (opt.checksums > 0 ? pageChecksums.size() : 0);	// from the start of the file
+		uint32_t dataPagesOffset = (nonResidentNamesOffset + nonResidentNames.size() + 0x1ff) & ~0x1ff;
+
+		std::vector<uint8_t> file(HEADER_OFFSET, 0);
+		file[0] = 'M';
+		file[1] = 'Z';
+		file[0x18] = 0x40;
+		put32(file, 0x3c, HEADER_OFFSET);
+		file.push_back('L');
+		file.push_back('E');
+		write_le<uint16_t>(file, 0);	// byte and word order
+		write_le<uint32_t>(file, 0);	// format version
+		write_le<uint16_t>(file, 2);	// 386
+		write_le<uint16_t>(file, 1);	// OS/2
+		write_le<uint32_t>(file, 0);	// module version
+		write_le<uint32_t>(file, 0);	// module flags
+		write_le<uint32_t>(file, pageCount);
+		write_le<uint32_t>(file, 1);	// eip object
+		write_le<uint32_t>(file, 0);	// eip offset: first function
+		write_le<uint32_t>(file, objects.size());	// esp object
+		write_le<uint32_t>(file, 0x10);
+		write_le<uint32_t>(file, PAGE_SIZE);
+		write_le<uint32_t>(file, PAGE_SIZE);	// last page size
+		write_le<uint32_t>(file, fixupPageTable.size() + fixupRecords.size());
+		write_le<uint32_t>(file, opt.checksums > 0 ? checksum(fixupPageTable, fixupRecords) : 0);
+		write_le<uint32_t>(file, opt.checksums > 0 ? objectTable.size() + pageTable.size() : 0);	// loader section: object and page tables here
+		write_le<uint32_t>(file, opt.checksums > 0 ? checksum(objectTable, pageTable) : 0);
+		write_le<uint32_t>(file, objectTableOffset);
+		write_le<uint32_t>(file, objects.size());
+		write_le<uint32_t>(file, pageTableOffset);
+		for (size_t n = 0; n < 3; ++n) {	// iterated pages, resources
+			write_le<uint32_t>(file, 0);
+		}
+		write_le<uint32_t>(file, opt.exports > 0 ? residentNamesOffset : 0);
+		write_le<uint32_t>(file, opt.exports > 0 ? entryTableOffset : 0);
+		for (size_t n = 0; n < 2; ++n) {	// directives
+			write_le<uint32_t>(file, 0);
+		}
+		write_le<uint32_t>(file, fixupPageTableOffset);
+		write_le<uint32_t>(file, fixupRecordTableOffset);
+		for (size_t n = 0; n < 3; ++n) {	// imports
+			write_le<uint32_t>(file, 0);
+		}
+		write_le<uint32_t>(file, opt.checksums > 0 ? pageChecksumsOffset : 0);
+		write_le<uint32_t>(file, dataPagesOffset);
+		write_le<uint32_t>(file, 0);	// preload pages
+		write_le<uint32_t>(file, opt.exports > 0 ? nonResidentNamesOffset : 0);
+		write_le<uint32_t>(file, nonResidentNames.size());
+		file.resize(HEADER_OFFSET + HEADER_SIZE, 0);
+		file.insert(file.end(), objectTable.begin(), objectTable.end());
+		file.insert(file.end(), pageTable.begin(), pageTable.end());
+		file.insert(file.end(), fixupPageTable.begin(), fixupPageTable.end());
+		file.insert(file.end(), fixupRecords.begin(), fixupRecords.end());
+		file.insert(file.end(), residentNames.begin(), residentNames.end());
+		file.insert(file.end(), entryTable.begin(), entryTable.end());
+		if (opt.checksums > 0) {
+			file.insert(file.end(), pageChecksums.begin(), pageChecksums.end());
+		}
+		file.insert(file.end(), nonResidentNames.begin(), nonResidentNames.end());
+		file.resize(dataPagesOffset, 0);
+		os.write((const char *) &file.front(), file.size());
+		for (size_t oi = 0; oi < objects.size(); ++oi) {
+			os.write((const char *) &objects[oi].data.front(), objects[oi].data.size());
+		}
+	}
+
+	size_t targetObject(uint32_t address) const {
+		for (size_t oi = 0; oi < objects.size(); ++oi) {
+			if (objects[oi].base_address <= address && address < objects[oi].base_address + objects[oi].data.size()) {
+				return oi;
+			}
+		}
+		throw std::runtime_error("fixup target outside of all objects");
+	}
+};
+
+static bool parseOption(const char *arg, const char *name, uint32_t &value) {
+	size_t len = strlen(name);
+	if (strncmp(arg, name, len) != 0 || arg[len] != '=') {
+		return false;
+	}
+	char *end;
+	value = strtoul(arg + len + 1, &end, 0);
+	if (*end == 'K' || *end == 'k') {
+		value <<= 10;
+	} else if (*end == 'M' || *end == 'm') {
+		value <<= 20;
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	Options opt;
+	uint32_t size = 0;
+	int argi = 1;
+	for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; ++argi) {
+		const char *arg = argv[argi];
+		if (!(parseOption(arg, "--size", size) || parseOption(arg, "--code-objects", opt.code_objects)
+				|| parseOption(arg, "--data-objects", opt.data_objects) || parseOption(arg, "--pages", opt.pages)
+				|| parseOption(arg, "--functions", opt.functions) || parseOption(arg, "--call-density", opt.call_density)
+				|| parseOption(arg, "--jump-density", opt.jump_density) || parseOption(arg, "--fpu-density", opt.fpu_density)
+				|| parseOption(arg, "--data-density", opt.data_density) || parseOption(arg, "--switches", opt.switches)
+				|| parseOption(arg, "--case-constants", opt.case_constants)
+				|| parseOption(arg, "--pointer-density", opt.pointer_density) || parseOption(arg, "--exports", opt.exports) || parseOption(arg, "--checksums", opt.checksums) || parseOption(arg, "--seed", opt.seed)
+				|| parseOption(arg, "--build", opt.build))) {
+			std::cerr << "Unknown option: " << arg << "\n";
+			return 1;
+		}
+	}
+	if (argi + 1 != argc || opt.code_objects == 0) {
+		std::cerr << "Usage: " << argv[0] << " [options] output.le\n"
+				"  --size=N[K|M]          total image size, overrides --pages\n"
+				"  --code-objects=N       executable objects (1)\n"
+				"  --data-objects=N       data objects (1)\n"
+				"  --pages=N              4 KiB pages per object (16)\n"
+				"  --functions=N          functions per code object (one per 256 bytes)\n"
+				"  --call-density=P       percent of instructions that are calls (8)\n"
+				"  --jump-density=P       percent of instructions that are short jumps (10)\n"
+				"  --fpu-density=P        percent of instructions with FPU data references (3)\n"
+				"  --data-density=P       percent of instructions with data references (6)\n"
+				"  --switches=N           switch tables per code object (4)\n"
+				"  --case-constants=P     percent of switches whose cases load an FPU constant following them (0)\n"
+				"  --pointer-density=P    percent of data chunks that are pointers (30)\n"
+				"  --exports=N            functions exported through the entry and name tables (0)\n"
+				"  --checksums=0|1        page and section checksums (0)\n"
+				"  --seed=N               random seed (1)\n"
+				"  --build=N              later builds of the same seed, N - 1 of every 100 functions changed (0: unrelated)\n";
+		return 1;
+	}
+	if (size > 0) {
+		opt.pages = std::max<uint32_t>(1, size / PAGE_SIZE / (opt.code_objects + opt.data_objects));
+	}
+	try {
+		Generator gen(opt);
+		gen.generate();
+		std::ofstream os(argv[argi], std::ofstream::binary);
+		gen.write(os);
+		if (!os.good()) {
+			std::cerr << "Error writing file: " << argv[argi] << "\n";
+			return 1;
+		}
+	} catch (const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
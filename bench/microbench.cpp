@@ -0,0 +1,160 @@
+/* Microbenchmarks of le_disasm hot paths on a given (e.g. le_gen generated) executable */
+#include <fstream>
+#include <cstring>
+#define PACKAGE
+
+#include "../print.h"
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct NullBuffer : std::streambuf {
+	int overflow(int c) {
+		return c;
+	}
+
+	std::streamsize xsputn(const char *, std::streamsize n) {
+		return n;
+	}
+};
+
+static NullBuffer nullBuffer;
+static std::ostream null(&nullBuffer);
+
+static void report(const char *name, size_t ops, size_t bytes, double seconds) {
+	FlagsRestorer _(std::cout);
+	std::cout << std::setfill(' ') << std::left << std::setw(32) << name << std::right << std::dec << std::setw(12) << ops << " ops"
+			<< std::fixed << std::setprecision(1) << std::setw(12) << seconds * 1e9 / std::max<size_t>(ops, 1) << " ns/op";
+	if (bytes > 0) {
+		std::cout << std::setw(12) << bytes / seconds / (1 << 20) << " MiB/s";
+	}
+	std::cout << std::endl;
+}
+
+/* Re-encodes the loaded fixups of the first 32 KiB of each object as 32-bit internal references */
+static void benchFixups(LinearExecutable &lx, Image &img, unsigned iterations) {
+	std::string records;
+	size_t count = 0;
+	for (size_t oi = 0; oi < lx.fixups.size(); ++oi) {
+		for (FixupMap::const_iterator itr = lx.fixups[oi].begin(); itr != lx.fixups[oi].end() && itr->first < 0x8000; ++itr) {
+			const ImageObject &target = img.objectAt(itr->second);
+			char record[9] = {0x07, 0x10};
+			write_le<int16_t>(record + 2, itr->first);
+			record[4] = target.index + 1;
+			write_le<uint32_t>(record + 5, itr->second - target.base_address);
+			records.append(record, sizeof(record));
+			++count;
+		}
+	}
+	double start = now();
+	uint64_t sum = 0;
+	for (unsigned i = 0; i < iterations; ++i) {
+		std::istringstream is(records);
+		for (size_t offset = 0; offset < records.size(); ) {
+			Fixup fixup(is, offset, lx.objects, 0);
+			sum += fixup.address;
+		}
+	}
+	report("Fixup decoding", count * iterations, records.size() * iterations, now() - start);
+	if (sum == 1) {
+		std::cout << std::endl;
+	}
+}
+
+static void benchSplitInsert(LinearExecutable &lx, unsigned iterations) {
+	size_t ops = 0;
+	double start = now();
+	for (unsigned i = 0; i < iterations; ++i) {
+		Regions regions(lx.objects, null);
+		Region *reg = regions.regionContaining(lx.objects[0].base_address);
+		/* alternate code and data so that nothing merges */
+		for (uint32_t addr = lx.objects[0].base_address; reg != NULL && reg->get_size() > 16; addr += 16, ++ops) {
+			regions.splitInsert(*reg, Region(addr, 8, (ops & 1) ? CODE : DATA));
+			reg = regions.regionContaining(addr + 8);
+		}
+	}
+	report("Regions::splitInsert", ops, 0, now() - start);
+}
+
+static void benchDisassemble(Image &img, unsigned iterations) {
+	const ImageObject &obj = img.objects[0];
+	DisInfo disasm;
+	Insn inst;
+	size_t ops = 0, bytes = 0;
+	double start = now();
+	for (unsigned i = 0; i < iterations; ++i) {
+		for (uint32_t addr = obj.base_address; addr < obj.base_address + obj.data.size(); addr += inst.size, ++ops) {
+			disasm.disassemble(addr, obj.get_data_at(addr), obj.base_address + obj.data.size() - addr, inst);
+			bytes += inst.size;
+		}
+	}
+	report("DisInfo::disassemble", ops, bytes, now() - start);
+}
+
+static void benchReplaceAddresses(LinearExecutable &lx, Image &img, Analyzer &anal, unsigned iterations) {
+	std::vector<std::string> texts;
+	Insn inst;
+	for (RegionMap::const_iterator itr = anal.regions.regions.begin(); itr != anal.regions.regions.end(); ++itr) {
+		const Region &reg = itr->second;
+		const ImageObject &obj = img.objectAt(reg.get_address());
+		for (uint32_t addr = reg.get_address(); CODE == reg.get_type() && addr < reg.get_end_address(); addr += inst.size) {
+			anal.disasm.disassemble(addr, obj.get_data_at(addr), reg.get_end_address() - addr, inst);
+			texts.push_back(inst.text);
+		}
+	}
+	size_t bytes = 0;
+	double start = now();
+	for (unsigned i = 0; i < iterations; ++i) {
+		for (size_t n = 0; n < texts.size(); ++n) {
+			bytes += replace_addresses_with_labels<AttSyntax>(texts[n], img, lx, anal).size();
+		}
+	}
+	report("replace_addresses_with_labels", texts.size() * iterations, bytes, now() - start);
+}
+
+static void benchPrintData(LinearExecutable &lx, Image &img, Analyzer &anal, unsigned iterations) {
+	size_t ops = 0, bytes = 0;
+	double start = now();
+	for (unsigned i = 0; i < iterations; ++i) {
+		for (RegionMap::const_iterator itr = anal.regions.regions.begin(); itr != anal.regions.regions.end(); ++itr) {
+			if (DATA == itr->second.get_type()) {
+				printDataTypeRegion<AttSyntax>(null, itr->second, img.objectAt(itr->second.get_address()), lx, img, anal);
+				bytes += itr->second.get_size();
+				++ops;
+			}
+		}
+	}
+	report("printDataTypeRegion", ops, bytes, now() - start);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " [main.exe] [iterations]\n";
+		return 1;
+	}
+	unsigned iterations = argc > 2 ? strtoul(argv[2], NULL, 0) : 3;
+	try {
+		std::ifstream is(argv[1]);
+		if (!is.is_open()) {
+			std::cerr << "Error opening file: " << argv[1];
+			return 1;
+		}
+		LinearExecutable lx(is, null);
+		Image image(is, lx);
+		Analyzer analyzer(lx, image, null);
+		analyzer.run(lx);
+		analyzer.buildLabelTable(lx);
+
+		benchFixups(lx, image, iterations);
+		benchSplitInsert(lx, iterations);
+		benchDisassemble(image, iterations);
+		benchReplaceAddresses(lx, image, analyzer, iterations);
+		benchPrintData(lx, image, analyzer, iterations);
+	} catch (const std::exception &e) {
+		std::cerr << std::dec << e.what() << std::endl;
+		return 1;
+	}
+}
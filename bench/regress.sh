@@ -0,0 +1,121 @@
+#!/bin/sh
+# Golden-output regression harness: runs le_disasm over a fixed set of synthetic executables and
+# the sample executables in bench/samples, compares a SHA-256 of stdout with bench/golden.txt and
+# appends wall time and peak RSS to a results file, flagging runs slower than golden by more than
+# the threshold. Inputs without a golden hash and runs exiting non-zero fail. Hinted re-analysis from a
+# saved state is checked against a full run. -u names the libopcodes le_disasm links in the first line.
+#
+# Usage: bench/regress.sh [-u] [-t percent] [-r results] [le_disasm] [le_gen]
+#   -u  (re)record golden hashes and timings instead of comparing
+#   -t  allowed slowdown in percent (20)
+#   -r  results file (regress_results.txt)
+DIR=$(dirname "$0")
+GOLDEN=$DIR/golden.txt
+UPDATE=0
+THRESHOLD=20
+RESULTS=regress_results.txt
+while getopts ut:r: opt; do
+	case $opt in
+	u) UPDATE=1 ;;
+	t) THRESHOLD=$OPTARG ;;
+	r) RESULTS=$OPTARG ;;
+	*) exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+LE_DISASM=${1:-./le_disasm}
+LE_GEN=${2:-./le_gen}
+WORK=${TMPDIR:-/tmp}/le_disasm_regress.$$
+mkdir -p "$WORK" || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+# name and le_gen arguments of the synthetic inputs, then le_disasm options after --; never change an
+# entry, add a new one instead
+SYNTHETIC="
+small --size=64K
+switches --size=256K --switches=64
+fpu --size=256K --fpu-density=20 --data-density=20
+calls --size=1M --call-density=25 --jump-density=25
+objects --size=1M --code-objects=3 --data-objects=2
+large --size=16M
+entropy-tail --size=1M --seed=11 --build=3 -- --entropy
+case-constants --size=256K --switches=64 --case-constants=50
+"
+
+echo "$SYNTHETIC" | while read name args; do
+	[ -z "$name" ] && continue
+	case "$args" in
+	*" -- "*) echo "${args#* -- }" > "$WORK/$name.opts"; args=${args%% -- *} ;;
+	esac
+	"$LE_GEN" $args "$WORK/$name.le" || exit 1
+done || exit 1
+for sample in "$DIR"/samples/*; do
+	[ "$(basename "$sample")" = README ] && continue
+	[ -f "$sample" ] && ln -s "$(cd "$(dirname "$sample")" && pwd)/$(basename "$sample")" "$WORK/sample-$(basename "$sample").le"
+done
+
+[ $UPDATE -eq 1 ] && : > "$WORK/golden"
+failures=0
+stamp=$(date '+%Y-%m-%dT%H:%M:%S')
+for input in "$WORK"/*.le; do
+	name=$(basename "$input" .le)
+	opts=$(cat "$WORK/$name.opts" 2> /dev/null)
+	{ "$LE_DISASM" $opts --stats-json="$WORK/$name.json" "$input" 2> /dev/null; echo $? > "$WORK/$name.rc"; } | sha256sum > "$WORK/$name.sum"
+	hash=$(cut -d' ' -f1 "$WORK/$name.sum")
+	rc=$(cat "$WORK/$name.rc")
+	set -- $(awk -f "$DIR/stats_total.awk" "$WORK/$name.json" 2> /dev/null)
+	wall=${1:-0} rss=${2:-0}
+	if [ "$rc" -ne 0 ]; then
+		status=EXIT-$rc
+		failures=$((failures + 1))
+	elif [ $UPDATE -eq 1 ]; then
+		echo "$name $hash $wall $rss" >> "$WORK/golden"
+		status=recorded
+	else
+		golden=$(grep "^$name " "$GOLDEN" 2> /dev/null)
+		if [ -z "$golden" ]; then
+			status=NEW	# record with -u
+			failures=$((failures + 1))
+		elif [ "$(echo "$golden" | cut -d' ' -f2)" != "$hash" ]; then
+			status=OUTPUT-CHANGED
+			failures=$((failures + 1))
+		elif echo "$golden $wall $THRESHOLD" | awk '{ exit !($5 > $3 * (1 + $6 / 100) && $5 - $3 > 0.05) }'; then
+			status=SLOWER
+			failures=$((failures + 1))
+		else
+			status=ok
+		fi
+	fi
+	echo "$stamp $name $hash $wall $rss $status" >> "$RESULTS"
+	printf "%-24s %10ss %10sKiB  %s\n" "$name" "$wall" "$rss" "$status"
+done
+
+# Re-analysis from a saved state must print what a full run with the same hints does, and both must define
+# every label they reference. Arguments: name, synthetic input and the hints file line.
+hinted() {
+	name=$1 input=$WORK/$2.le
+	shift 2
+	echo "$*" > "$WORK/$name.hints"
+	if ! "$LE_DISASM" --hints="$WORK/$name.hints" "$input" > "$WORK/$name.full.S" 2> /dev/null \
+			|| ! "$LE_DISASM" --state="$WORK/$name.state" "$input" > /dev/null 2>&1 \
+			|| ! "$LE_DISASM" --state="$WORK/$name.state" --hints="$WORK/$name.hints" "$input" > "$WORK/$name.state.S" 2> /dev/null; then
+		status=EXIT
+	elif ! cmp -s "$WORK/$name.full.S" "$WORK/$name.state.S"; then
+		status=STATE-DIFFERS
+	else
+		grep -o '_[0-9a-f]\{6\}_[a-z]*' "$WORK/$name.full.S" | sort -u > "$WORK/$name.refs"
+		grep -o '^[[:space:]]*_[0-9a-f]\{6\}_[a-z]*:' "$WORK/$name.full.S" | tr -d ' \t:' | sort -u > "$WORK/$name.defs"
+		[ -z "$(comm -23 "$WORK/$name.refs" "$WORK/$name.defs")" ] && status=ok || status=UNDEFINED-LABEL
+	fi
+	[ $status = ok ] || failures=$((failures + 1))
+	echo "$stamp $name - - - $status" >> "$RESULTS"
+	printf "%-24s %11s %13s  %s\n" "$name" - - "$status"
+}
+hinted small-force-data small force-data 0104b0	# a function called from elsewhere
+
+if [ $UPDATE -eq 1 ] && [ $failures -eq 0 ]; then
+	libopcodes=$(ldd "$LE_DISASM" 2> /dev/null | sed -n 's/^[[:space:]]*\(libopcodes[^ ]*\).*/\1/p' | head -n 1)
+	{ echo "# ${libopcodes:-libopcodes version unknown}"; sort "$WORK/golden"; } > "$GOLDEN"
+	echo "Golden values written to $GOLDEN"
+fi
+[ $failures -eq 0 ]
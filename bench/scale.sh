@@ -0,0 +1,20 @@
+#!/bin/sh
+# Generates synthetic executables of growing size and reports le_disasm throughput per size.
+# Usage: bench/scale.sh le_disasm le_gen [sizes...]
+[ $# -ge 2 ] || { echo "Usage: $0 le_disasm le_gen [sizes...]" >&2; exit 1; }
+LE_DISASM=$1
+LE_GEN=$2
+shift 2
+SIZES=${*:-64K 256K 1M 4M 16M 64M 256M}
+WORK=${TMPDIR:-/tmp}/le_disasm_scale.$$
+mkdir -p "$WORK" || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+printf "%-8s %10s %10s %10s %12s\n" size "wall[s]" "peak[KiB]" "MiB/s" "insns"
+for size in $SIZES; do
+	"$LE_GEN" --size="$size" "$WORK/$size.le" || exit 1
+	"$LE_DISASM" --stats-json="$WORK/$size.json" "$WORK/$size.le" > /dev/null 2>&1 || exit 1
+	bytes=$(wc -c < "$WORK/$size.le")
+	echo "$size $bytes $(awk -f "$(dirname "$0")/stats_total.awk" "$WORK/$size.json")" |
+		awk '{ printf "%-8s %10.3f %10d %10.2f %12d\n", $1, $3, $4, $2 / $3 / 1048576, $5 }'
+done
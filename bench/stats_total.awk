@@ -0,0 +1,8 @@
+# Sums the phases of a le_disasm --stats-json file: prints "wall peak_rss_kb instructions"
+BEGIN { RS = "{" }
+/"wall"/ {
+	match($0, /"wall": [0-9.]+/); wall += substr($0, RSTART + 8, RLENGTH - 8)
+	match($0, /"peak_rss_kb": [0-9]+/); rss = substr($0, RSTART + 15, RLENGTH - 15)
+	match($0, /"instructions": [0-9]+/); insns += substr($0, RSTART + 16, RLENGTH - 16)
+}
+END { printf "%.6f %d %d\n", wall, rss, insns }
@@ -0,0 +1,52 @@
+/* Checks NasmSyntax::fix against text objdump -M intel (binutils 2.4x) prints, as is and lowercased by Insn */
+#include <iostream>
+#include <string>
+#define PACKAGE
+
+#include "../syntax.h"
+
+static const char *cases[][2] = {
+	{"mov    DWORD PTR [ebp-0x4],0x1", "mov    dword [ebp-0x4],0x1"},
+	{"fstp   QWORD PTR ds:0x401000", "fstp   qword [0x401000]"},
+	{"rep movs DWORD PTR es:[edi],DWORD PTR ds:[esi]", "rep movsd"},
+	{"movs   BYTE PTR es:[edi],BYTE PTR ds:[esi]", "movsb"},
+	{"rep stos DWORD PTR es:[edi],eax", "rep stosd"},
+	{"scas   al,BYTE PTR es:[edi]", "scasb"},
+	{"cmps   WORD PTR ds:[esi],WORD PTR es:[edi]", "cmpsw"},
+	{"fld    TBYTE PTR [eax]", "fld    tword [eax]"},
+	{"fstp   st(1)", "fstp   st1"},
+	{"fxch   st(3)", "fxch   st3"},
+	{"fadd   st,st(2)", "fadd   st0,st2"},
+	{"jmp    FWORD PTR [eax]", "jmp    far [eax]"},
+	{"call   FWORD PTR [ebx+0x4]", "call   far [ebx+0x4]"},
+	{"les    eax,FWORD PTR [ebx]", "les    eax,[ebx]"},
+	{"lea    esi,[esi+eiz*1+0x0]", "lea    esi,[esi+0x0]"},
+	{"mov    eax,fs:0x0", "mov    eax,[fs:0x0]"},
+	{"mov    eax,ds:0x401000", "mov    eax,[0x401000]"},
+	{"mov    ax,WORD PTR es:[ebx]", "mov    ax,word [es:ebx]"},
+	{"add    DWORD PTR gs:[eax+0x4],0x10", "add    dword [gs:eax+0x4],0x10"},
+	{"lock cmpxchg DWORD PTR [ecx],edx", "lock cmpxchg dword [ecx],edx"},
+	{"movaps xmm0,XMMWORD PTR [eax]", "movaps xmm0,oword [eax]"},
+	{"jmp    DWORD PTR [eax*4+0x401000]", "jmp    dword [eax*4+0x401000]"},
+	{"fld    QWORD PTR ds:_0a5848_data", "fld    qword [_0a5848_data]"},	// after label replacement
+	{"data16", "o16"},
+	{"ret", "ret"}
+};
+
+int main(void) {
+	int failures = 0;
+	for (size_t n = 0; n < sizeof(cases)/sizeof(cases[0]); ++n) {
+		for (int lowered = 0; lowered < 2; ++lowered) {
+			std::string str = cases[n][0];
+			for (size_t i = 0; lowered && i < str.size(); str[i] = tolower(str[i]), ++i);
+			std::string input = str;
+			NasmSyntax::fix(str);
+			if (str != cases[n][1]) {
+				std::cerr << "\"" << input << "\" gives \"" << str << "\", expected \"" << cases[n][1] << "\"\n";
+				++failures;
+			}
+		}
+	}
+	std::cout << failures << " of " << 2 * sizeof(cases)/sizeof(cases[0]) << " failed\n";
+	return 0 != failures;
+}
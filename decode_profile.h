@@ -0,0 +1,115 @@
+#ifndef SRC_DECODE_PROFILE_H_
+#define SRC_DECODE_PROFILE_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "flags_restorer.h"
+#include "type.h"
+
+/* Counts DisInfo::disassemble calls per address and call site, enabled by --decode-profile.
+ * Every decode of an already decoded address is work a decode cache would save.
+ */
+struct DecodeProfile {
+	enum Site {
+		TRACE,		// Analyzer::traceRegionUntilAnyJump
+		FUNC_GUESS,	// FUNC_GUESS re-check of already traced code
+		PRINT,		// printCodeTypeRegion
+		SUPERSET,	// SupersetRegion::decode
+		SITE_COUNT
+	};
+
+	struct Entry {
+		uint32_t count;
+		uint32_t size;
+		uint32_t site_counts[SITE_COUNT];
+
+		Entry(void) : count(0), size(0) {
+			std::fill(site_counts, site_counts + SITE_COUNT, 0);
+		}
+	};
+
+	std::map<uint32_t, Entry> addresses;
+	uint64_t site_totals[SITE_COUNT];
+	uint64_t site_repeats[SITE_COUNT];
+
+	DecodeProfile(void) {
+		std::fill(site_totals, site_totals + SITE_COUNT, 0);
+		std::fill(site_repeats, site_repeats + SITE_COUNT, 0);
+	}
+
+	void record(uint32_t address, size_t size, Site site) {
+		Entry &entry = addresses[address];
+		if (entry.count++ > 0) {
+			++site_repeats[site];
+		}
+		entry.size = std::max<uint32_t>(entry.size, size);
+		++entry.site_counts[site];
+		++site_totals[site];
+	}
+
+	std::ostream &printReport(std::ostream &os, size_t top = 20) const {
+		FlagsRestorer _(os);
+		static const char *siteNames[SITE_COUNT] = {"trace", "func guess", "print", "superset"};
+		uint64_t total = 0, repeats = 0;
+		for (size_t s = 0; s < SITE_COUNT; ++s) {
+			total += site_totals[s];
+			repeats += site_repeats[s];
+		}
+		os << std::dec << "Decode profile: " << total << " decode(s) of " << addresses.size() << " address(es), "
+				<< repeats << " repeated (" << std::fixed << std::setprecision(1) << percent(repeats, total) << "% avoidable by a decode cache)" << std::endl;
+		for (size_t s = 0; s < SITE_COUNT; ++s) {
+			os << "  " << std::left << std::setw(12) << siteNames[s] << std::right << std::setw(12) << site_totals[s]
+					<< " decode(s), " << std::setw(12) << site_repeats[s] << " repeated" << std::endl;
+		}
+
+		/* byte histogram: how many bytes were covered by 1, 2, 3... decodes */
+		std::map<uint32_t/*address*/, uint32_t/*decodes*/> bytes;
+		for (std::map<uint32_t, Entry>::const_iterator itr = addresses.begin(); itr != addresses.end(); ++itr) {
+			for (uint32_t n = 0; n < itr->second.size; ++n) {
+				bytes[itr->first + n] += itr->second.count;
+			}
+		}
+		std::map<uint32_t/*decodes*/, uint64_t/*bytes*/> histogram;
+		for (std::map<uint32_t, uint32_t>::const_iterator itr = bytes.begin(); itr != bytes.end(); ++itr) {
+			++histogram[itr->second];
+		}
+		os << "  bytes by decode count:";
+		for (std::map<uint32_t, uint64_t>::const_iterator itr = histogram.begin(); itr != histogram.end(); ++itr) {
+			os << " " << itr->first << "x:" << itr->second;
+		}
+		os << std::endl;
+
+		std::vector<std::pair<uint32_t/*count*/, uint32_t/*address*/> > offenders;
+		for (std::map<uint32_t, Entry>::const_iterator itr = addresses.begin(); itr != addresses.end(); ++itr) {
+			if (itr->second.count > 1) {
+				offenders.push_back(std::make_pair(itr->second.count, itr->first));
+			}
+		}
+		std::sort(offenders.begin(), offenders.end(), compareOffenders);
+		os << "  top repeatedly decoded addresses:" << std::endl;
+		for (size_t n = 0; n < offenders.size() && n < top; ++n) {
+			const Entry &entry = addresses.find(offenders[n].second)->second;
+			printAddress(os << "    ", offenders[n].second) << std::dec << ": " << entry.count << "x";
+			for (size_t s = 0; s < SITE_COUNT; ++s) {
+				os << " " << siteNames[s] << "=" << entry.site_counts[s];
+			}
+			os << std::endl;
+		}
+		return os;
+	}
+private:
+	static double percent(uint64_t part, uint64_t whole) {
+		return whole > 0 ? 100.0 * part / whole : 0.0;
+	}
+
+	static bool compareOffenders(const std::pair<uint32_t, uint32_t> &a, const std::pair<uint32_t, uint32_t> &b) {
+		return a.first != b.first ? a.first > b.first : a.second < b.second;
+	}
+};
+
+#endif /* SRC_DECODE_PROFILE_H_ */
@@ -1,37 +1,72 @@
 #ifndef SRC_DIS_INFO_H_
 #define SRC_DIS_INFO_H_
 
+#include <pthread.h>
+#include <stdint.h>
 #include <dis-asm.h>
 
 extern "C" int print_insn_i386_att (bfd_vma pc, disassemble_info *info);
+extern "C" int print_insn_i386_intel (bfd_vma pc, disassemble_info *info);
 
+#include "decode_profile.h"
 #include "insn.h"
 
 class DisInfo : disassemble_info {
+	/* libopcodes keeps the state of the instruction being decoded in globals */
+	static pthread_mutex_t &libopcodesMutex(void) {
+		static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+		return mutex;
+	}
+
+	/* libopcodes 2.39 and later print most of an instruction through this one, the text keeps no styles */
+	static int callbackStyledText(void *stream, enum disassembler_style, const char *fmt, ...) {
+		va_list list;
+		va_start(list, fmt);
+		int ret = Insn::appendText(stream, fmt, list);
+		va_end(list);
+		return ret;
+	}
+
 	static void callbackPrintAddress(bfd_vma address, disassemble_info *info) {
 		info->fprintf_func(info->stream, "0x00%lx", address);
 		((Insn *) info->stream)->memoryAddress = address;
 	}
 public:
-	DisInfo() {
-		init_disassemble_info(this, NULL, &Insn::callbackResetTypeAndText);
+	/** instructions decoded so far, see Stats */
+	uint64_t decoded;
+	DecodeProfile *profile;	// optional
+
+	DisInfo() : decoded(0), profile(NULL) {
+		init_disassemble_info(this, NULL, &Insn::callbackResetTypeAndText, &callbackStyledText);
 		mach = bfd_mach_i386_i386;
 		print_address_func = callbackPrintAddress;
 	}
 
-	void disassemble(uint32_t addr, const void *data, size_t length, Insn &insn) {
+	void disassemble(uint32_t addr, const void *data, size_t length, Insn &insn, DecodeProfile::Site site = DecodeProfile::TRACE) {
+		disassemble<print_insn_i386_att>(addr, data, length, insn, site);
+	}
+
+	/* In the syntax of printInsn, print_insn_i386_att or print_insn_i386_intel */
+	template<int (*printInsn)(bfd_vma, disassemble_info *)>
+	void disassemble(uint32_t addr, const void *data, size_t length, Insn &insn, DecodeProfile::Site site = DecodeProfile::TRACE) {
 		buffer = (bfd_byte *) data;
 		buffer_length = length;
 		buffer_vma = addr;
 		stream = &insn;
 		insn.reset();
-		int size = print_insn_i386_att(addr, this);
+		++decoded;
+		pthread_mutex_lock(&libopcodesMutex());
+		int size = printInsn(addr, this);
+		pthread_mutex_unlock(&libopcodesMutex());
 		if (size < 0) {	// FIXME: dump arguments to error
 			throw Error() << "Failed to disassemble instruction";
 		}
 		insn.setSize(size);
+		if (NULL != profile) {
+			profile->record(addr, size, site);
+		}
 		if (size > 0) {
-			insn.setTargetAndType(addr, data);
+			insn.setTargetAndType(addr, data, print_insn_i386_att == printInsn);
 		}
 	}
 };
@@ -0,0 +1,74 @@
+#ifndef SRC_ENTROPY_H_
+#define SRC_ENTROPY_H_
+
+#include <stdint.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/* Byte entropy of 4 KiB pages, to tell compressed or encrypted blobs and fill apart from code without
+ * decoding them. x86 code has 5.5 to 6.5 bits per byte, compressed data close to 8, fill close to 0.
+ * Enabled by --entropy, see Analyzer::skipNonCodePages.
+ */
+class EntropyClassifier {
+	std::vector<double> count_log;	// count * log2(count) by count, saves a log per histogram bin
+public:
+	enum {
+		PAGE_SIZE = 4096
+	};
+
+	double low, high;	// bits per byte, pages at or outside them are not code
+
+	EntropyClassifier(double low_ = 1.0, double high_ = 7.5) : count_log(PAGE_SIZE + 1, 0.0), low(low_), high(high_) {
+		for (size_t n = 2; n <= PAGE_SIZE; ++n) {
+			count_log[n] = n * std::log((double) n) / std::log(2.0);
+		}
+	}
+
+	/* "LOW,HIGH" in bits per byte, either may be empty to keep its default */
+	bool parse(const char *spec) {
+		char *end;
+		if (*spec != ',') {
+			low = strtod(spec, &end);
+			if (end == spec) {
+				return false;
+			}
+			spec = end;
+		}
+		if (*spec == ',' && *++spec != 0) {
+			high = strtod(spec, &end);
+			if (end == spec) {
+				return false;
+			}
+			spec = end;
+		}
+		return *spec == 0 && low < high;
+	}
+
+	/* Bits per byte of at most PAGE_SIZE bytes */
+	double entropy(const uint8_t *data, size_t size) const {
+		/* four histograms, so that runs of equal bytes do not wait for the previous increment of the same counter */
+		uint32_t counts[4][256] = {{0}};
+		size_t n = 0;
+		for (; n + 4 <= size; n += 4) {
+			++counts[0][data[n]];
+			++counts[1][data[n + 1]];
+			++counts[2][data[n + 2]];
+			++counts[3][data[n + 3]];
+		}
+		for (; n < size; ++n) {
+			++counts[0][data[n]];
+		}
+		double sum = 0;
+		for (size_t b = 0; b < 256; ++b) {
+			sum += count_log[counts[0][b] + counts[1][b] + counts[2][b] + counts[3][b]];
+		}
+		return size > 0 ? count_log[size] / size - sum / size : 0;
+	}
+
+	bool isCode(double bits) const {
+		return low < bits && bits < high;
+	}
+};
+
+#endif /* SRC_ENTROPY_H_ */
@@ -13,7 +13,16 @@
 //                     <<" health points!";
 struct Error : public std::exception {
 	Error() {
-		print_stacktrace();
+		if (stackTraces()) {
+			print_stacktrace();
+		}
+	}
+
+	/* Whether constructing an Error prints the stack trace to stderr, off by default as walking
+	 * and demangling the stack costs more than most errors are worth, see --stacktrace */
+	static bool &stackTraces(void) {
+		static bool enabled = false;
+		return enabled;
 	}
 
 	Error(const Error &that) {
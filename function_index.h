@@ -0,0 +1,280 @@
+#ifndef SRC_FUNCTION_INDEX_H_
+#define SRC_FUNCTION_INDEX_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "function_table.h"
+#include "label_table.h"
+#include "little_endian.h"
+#include "log.h"
+#include "mapped_file.h"
+
+/* Functions of a corpus of titles by FunctionTable hash, so that shared runtime and middleware code is
+ * named and told apart from code of the title at hand. --build-index merges the functions of analyzed
+ * titles into the file, --index names the functions of an analysis found in it.
+ *
+ * The file is mapped as is. Entries are sorted by hash and size, and a directory holds the first entry of
+ * each value of the top hash bits, so that a lookup reads about one entry however many the file holds:
+ *   header: "LEFUNIDX", version, entry count, directory bits, string pool size
+ *   directory: (1 << bits) + 1 entry indexes
+ *   entries: hash (64 bits), size, name, title, address in title, titles seen in
+ *   string pool: 0-terminated names and titles referred to by offset, 0 for the empty one
+ * with 32 bit little endian fields unless noted.
+ */
+class FunctionIndex {
+	enum {
+		VERSION = 1,
+		HEADER = 24,
+		ENTRY = 28,
+		MAX_BITS = 24
+	};
+
+	MappedFile file;
+	const uint8_t *data;
+	uint32_t count;
+	uint32_t bits;
+	const uint8_t *entries;
+	const char *pool;
+	uint32_t poolSize;
+
+	static const char *magic(void) {
+		return "LEFUNIDX";
+	}
+
+	const uint8_t *entry(size_t n) const {
+		return entries + n * ENTRY;
+	}
+
+	const char *string(uint32_t offset) const {
+		return offset < poolSize ? pool + offset : "";
+	}
+
+	uint32_t firstEntry(uint32_t bucket) const {
+		return read_le<uint32_t>(data + HEADER + bucket * sizeof(uint32_t));
+	}
+
+	/* Whether the directory of size entries does not decrease and ends at count, so that find stays within entries */
+	bool validDirectory(uint64_t size) const {
+		for (uint32_t bucket = 1; bucket < size; ++bucket) {
+			if (firstEntry(bucket) < firstEntry(bucket - 1)) {
+				return false;
+			}
+		}
+		return firstEntry(size - 1) == count;
+	}
+public:
+	enum {
+		MIN_SIZE = FunctionTable::PREFIX	// smaller functions are too alike to tell apart
+	};
+
+	static const size_t npos = (size_t) -1;
+
+	/* A function as --build-index collects and merges it */
+	struct Entry {
+		uint64_t hash;
+		uint32_t size;
+		std::string name;	// empty for none
+		std::string title;	// first seen in
+		uint32_t address;	// in title
+		uint32_t titles;
+
+		bool operator<(const Entry &other) const {
+			return hash != other.hash ? hash < other.hash : size < other.size;
+		}
+	};
+
+	FunctionIndex(void) : data(NULL), count(0), bits(0), entries(NULL), pool(NULL), poolSize(0) {}
+
+	/* Maps the file at path, false if there is none */
+	bool open(const char *path) {
+		close();
+		if (!file.open(path)) {
+			return false;
+		} else if (file.size() < HEADER) {
+			close();
+			throw Error() << "Invalid function index: " << path;
+		}
+		data = file.data();
+		size_t length = file.size();
+		count = read_le<uint32_t>(data + 12);
+		bits = read_le<uint32_t>(data + 16);
+		poolSize = read_le<uint32_t>(data + 20);
+		uint64_t directory = ((uint64_t) 1 << std::min<uint32_t>(bits, MAX_BITS)) + 1;
+		if (memcmp(data, magic(), 8) != 0 || read_le<uint32_t>(data + 8) != VERSION || bits > MAX_BITS
+				|| length != HEADER + directory * sizeof(uint32_t) + (uint64_t) count * ENTRY + poolSize
+				|| (poolSize > 0 && 0 != data[length - 1]) || !validDirectory(directory)) {
+			close();
+			throw Error() << "Invalid function index: " << path;
+		}
+		entries = data + HEADER + directory * sizeof(uint32_t);
+		pool = (const char *) entries + (size_t) count * ENTRY;
+		return true;
+	}
+
+	void close(void) {
+		file.close();
+		data = NULL;
+		count = 0;
+	}
+
+	size_t size(void) const {
+		return count;
+	}
+
+	/* Entry of the function of size bytes with hash, npos for none */
+	size_t find(uint64_t hash, uint32_t size) const {
+		if (0 == count) {
+			return npos;
+		}
+		uint32_t bucket = 0 == bits ? 0 : (uint32_t) (hash >> (64 - bits));
+		for (uint32_t n = firstEntry(bucket), end = firstEntry(bucket + 1); n < end; ++n) {
+			uint64_t other = read_le<uint64_t>(entry(n));
+			if (other == hash && read_le<uint32_t>(entry(n) + 8) == size) {
+				return n;
+			} else if (other > hash) {
+				break;
+			}
+		}
+		return npos;
+	}
+
+	Entry get(size_t n) const {
+		const uint8_t *p = entry(n);
+		Entry e = {read_le<uint64_t>(p), read_le<uint32_t>(p + 8), string(read_le<uint32_t>(p + 12)), string(read_le<uint32_t>(p + 16)),
+				read_le<uint32_t>(p + 20), read_le<uint32_t>(p + 24)};
+		return e;
+	}
+
+	const char *name(size_t n) const {
+		return string(read_le<uint32_t>(entry(n) + 12));
+	}
+
+	/* Names functions of table found in the index unless symbols name them or another function already */
+	void label(const FunctionTable &table, std::map<uint32_t, std::string> &symbols, std::ostream &log) const {
+		std::set<std::string> used;
+		for (std::map<uint32_t, std::string>::const_iterator symbol = symbols.begin(); symbol != symbols.end(); ++symbol) {
+			used.insert(symbol->second);
+		}
+		size_t known = 0, named = 0;
+		for (size_t n = 0; n < table.functions.size(); ++n) {
+			const FunctionTable::Function &fn = table.functions[n];
+			size_t found = fn.size < MIN_SIZE ? npos : find(fn.hash, fn.size);
+			if (npos == found) {
+				continue;
+			}
+			++known;
+			const char *knownName = name(found);
+			if ('\0' != *knownName && symbols.end() == symbols.find(fn.address) && !LabelTable::reserved(LabelTable::sanitize(knownName))
+					&& used.insert(LabelTable::sanitize(knownName)).second) {
+				symbols[fn.address] = LabelTable::sanitize(knownName);
+				++named;
+			} else if ('\0' != *knownName && logging(log, LOG_TRACE, LOG_DEBUG)) {
+				printAddress(log, fn.address, "Not naming ") << ' ' << knownName << ", named or taken already\n";
+			}
+		}
+		if (logging(log, LOG_TRACE, LOG_INFO)) {
+			log << std::dec << "Index: " << known << " of " << table.functions.size() << " function(s) known, " << named << " named\n";
+		}
+	}
+
+	/* Adds the functions of table of a title, once each, named by symbols */
+	static void collect(std::vector<Entry> &added, const FunctionTable &table, const std::map<uint32_t, std::string> &symbols, const std::string &title) {
+		size_t first = added.size();
+		for (size_t n = 0; n < table.functions.size(); ++n) {
+			const FunctionTable::Function &fn = table.functions[n];
+			if (fn.size < MIN_SIZE) {
+				continue;
+			}
+			std::map<uint32_t, std::string>::const_iterator symbol = symbols.find(fn.address);
+			Entry e = {fn.hash, fn.size, symbols.end() != symbol ? symbol->second : std::string(), title, fn.address, 1};
+			added.push_back(e);
+		}
+		combine(added, first, false);
+	}
+
+	/* Merges added into the index at path, creating it if there is none, and returns its entry count. Of
+	 * alike functions, the first one named keeps its name and the first one seen its title and address.
+	 */
+	static size_t merge(const char *path, std::vector<Entry> &added) {
+		std::vector<Entry> all;
+		FunctionIndex previous;
+		if (previous.open(path)) {
+			all.reserve(previous.size() + added.size());
+			for (size_t n = 0; n < previous.size(); ++n) {
+				all.push_back(previous.get(n));
+			}
+			previous.close();
+		}
+		all.insert(all.end(), added.begin(), added.end());
+		combine(all, 0, true);
+		write(path, all);
+		return all.size();
+	}
+private:
+	/* Sorts entries from first on and keeps the first of alike ones, named by the first named one */
+	static void combine(std::vector<Entry> &entries, size_t first, bool addTitles) {
+		std::stable_sort(entries.begin() + first, entries.end());
+		std::vector<Entry>::iterator out = entries.begin() + first;
+		for (std::vector<Entry>::iterator in = out; in != entries.end(); ++in) {
+			if (out != entries.begin() + first && !(*(out - 1) < *in)) {
+				if ((out - 1)->name.empty()) {
+					(out - 1)->name = in->name;
+				}
+				(out - 1)->titles += addTitles ? in->titles : 0;
+			} else {
+				*out++ = *in;
+			}
+		}
+		entries.erase(out, entries.end());
+	}
+
+	/* Writes sorted entries to a temporary file renamed over path */
+	static void write(const char *path, const std::vector<Entry> &all) {
+		uint32_t bits = 0;
+		for (; bits < MAX_BITS && ((size_t) 1 << bits) < all.size(); ++bits);
+		std::vector<uint8_t> buffer(HEADER + (((size_t) 1 << bits) + 1) * sizeof(uint32_t) + all.size() * ENTRY);
+		memcpy(&buffer[0], magic(), 8);
+		write_le<uint32_t>(&buffer[8], VERSION);
+		write_le<uint32_t>(&buffer[12], all.size());
+		write_le<uint32_t>(&buffer[16], bits);
+		size_t at = HEADER;
+		for (size_t bucket = 0, n = 0; bucket <= ((size_t) 1 << bits); ++bucket, at += sizeof(uint32_t)) {
+			for (; n < all.size() && (0 == bits ? 0 : all[n].hash >> (64 - bits)) < bucket; ++n);
+			write_le<uint32_t>(&buffer[at], n);
+		}
+		std::string strings(1, '\0');
+		std::map<std::string, uint32_t> offsets;	// titles repeat
+		for (size_t n = 0; n < all.size(); ++n, at += ENTRY) {
+			write_le<uint64_t>(&buffer[at], all[n].hash);
+			write_le<uint32_t>(&buffer[at + 8], all[n].size);
+			write_le<uint32_t>(&buffer[at + 12], intern(strings, offsets, all[n].name));
+			write_le<uint32_t>(&buffer[at + 16], intern(strings, offsets, all[n].title));
+			write_le<uint32_t>(&buffer[at + 20], all[n].address);
+			write_le<uint32_t>(&buffer[at + 24], all[n].titles);
+		}
+		write_le<uint32_t>(&buffer[20], strings.size());
+		buffer.insert(buffer.end(), strings.begin(), strings.end());
+		MappedFile::write(path, buffer);
+	}
+
+	static uint32_t intern(std::string &strings, std::map<std::string, uint32_t> &offsets, const std::string &value) {
+		if (value.empty()) {
+			return 0;
+		}
+		std::map<std::string, uint32_t>::iterator itr = offsets.find(value);
+		if (offsets.end() == itr) {
+			itr = offsets.insert(std::make_pair(value, (uint32_t) strings.size())).first;
+			strings.append(value.c_str(), value.size() + 1);
+		}
+		return itr->second;
+	}
+};
+
+#endif /* SRC_FUNCTION_INDEX_H_ */
@@ -0,0 +1,135 @@
+#ifndef SRC_FUNCTION_TABLE_H_
+#define SRC_FUNCTION_TABLE_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "regions.h"
+#include "trace_graph.h"
+#include "le/image.h"
+#include "le/lin_ex.h"
+
+/* Position-independent hashes of the functions of an analysis, saved with its --state so that the analysis
+ * of a later build can take over functions whose bytes did not change, see Baseline.
+ *
+ * A function spans from its label to the next function label, without the unknown bytes at its end. Its
+ * references are its fixups and the rel32 of its traced branches. Its hash is of its bytes with those
+ * zeroed, so it stays the same when the function or what it refers to moves.
+ */
+struct FunctionTable {
+	enum {
+		PREFIX = 16	// bytes hashed on their own to find candidates quickly
+	};
+
+	enum ReferenceKind {
+		RELATIVE, FIXUP, SELECTOR
+	};
+
+	struct Reference {
+		uint32_t offset;	// from the function
+		uint32_t target;
+		uint8_t kind;
+		uint8_t type;	// label a branch gave the target, FUNCTION or JUMP, UNKNOWN for fixups
+		uint8_t island;	// size of the FPU operand split out as data at the target, 0 for none
+
+		uint32_t size(void) const {
+			return SELECTOR == kind ? 2 : 4;	// as Image::applyFixups writes them
+		}
+
+		static bool offsetLess(const Reference &a, const Reference &b) {
+			return a.offset < b.offset;
+		}
+	};
+
+	struct Function {
+		uint32_t address;
+		uint32_t size;
+		uint64_t hash;
+		uint64_t prefix;	// hash of the first PREFIX bytes
+		uint32_t first;	// of its references
+		uint32_t count;
+
+		uint32_t end(void) const {
+			return address + size;
+		}
+	};
+
+	std::vector<Function> functions;	// by address
+	std::vector<Reference> references;	// by function, then offset
+	uint32_t entry;
+	std::vector<uint32_t> exports;	// addresses by entry table index
+
+	FunctionTable(void) : entry(0) {}
+
+	/* FNV-1a of size bytes at data, those the count references cover zeroed, continuing from value if given */
+	static uint64_t hash(const uint8_t *data, uint32_t size, const Reference *refs, size_t count, uint64_t value = 14695981039346656037ULL) {
+		size_t ref = 0;
+		for (uint32_t off = 0; off < size; ++off) {
+			for (; ref < count && refs[ref].offset + refs[ref].size() <= off; ++ref);
+			uint8_t byte = (ref < count && refs[ref].offset <= off) ? 0 : data[off];
+			value = (value ^ byte) * 1099511628211ULL;
+		}
+		return value;
+	}
+
+	/* Functions of the analysis in regions, sorts the displacements of graph */
+	void collect(const Regions &regions, TraceGraph &graph, LinearExecutable &lx, const Image &image) {
+		std::sort(graph.displacements.begin(), graph.displacements.end());
+		graph.displacements.erase(std::unique(graph.displacements.begin(), graph.displacements.end()), graph.displacements.end());
+		entry = lx.entryPointAddress();
+		for (size_t n = 0; n < lx.exports.entries.size(); ++n) {
+			exports.push_back(lx.exports.entries[n].address);
+		}
+		for (LabelMap::const_iterator label = regions.labelTypes.begin(); label != regions.labelTypes.end(); ++label) {
+			const ImageObject *obj = image.findObject(label->first);
+			RegionMap::const_iterator reg = regions.regions.upper_bound(label->first);
+			if (FUNCTION != label->second || NULL == obj || !obj->executable || regions.regions.begin() == reg
+					|| CODE != (--reg)->second.get_type() || !reg->second.contains_address(label->first)) {
+				continue;
+			}
+			uint32_t limit = obj->base_address + obj->data.size();
+			LabelMap::const_iterator next = label;
+			for (++next; regions.labelTypes.end() != next && FUNCTION != next->second; ++next);
+			if (regions.labelTypes.end() != next) {
+				limit = std::min(limit, next->first);
+			}
+			uint32_t end = label->first;
+			for (; regions.regions.end() != reg && reg->first < limit; ++reg) {
+				if (UNKNOWN != reg->second.get_type()) {
+					end = std::min<size_t>(limit, reg->second.get_end_address());
+				}
+			}
+			Function fn = {label->first, end - label->first, 0, 0, (uint32_t) references.size(), 0};
+			addReferences(fn, *obj, lx.fixups[obj->index], graph);
+			fn.count = references.size() - fn.first;
+			const Reference *refs = references.empty() ? NULL : &references.front() + fn.first;
+			fn.hash = hash(obj->get_data_at(fn.address), fn.size, refs, fn.count);
+			fn.prefix = hash(obj->get_data_at(fn.address), std::min<uint32_t>(PREFIX, fn.size), refs, fn.count);
+			functions.push_back(fn);
+		}
+	}
+private:
+	void addReferences(const Function &fn, const ImageObject &obj, const FixupMap &fixups, const TraceGraph &graph) {
+		FixupMap::const_iterator fixup = fixups.lower_bound(fn.address - obj.base_address);
+		for (; fixups.end() != fixup && obj.base_address + fixup->first < fn.end(); ++fixup) {
+			std::map<uint32_t, uint32_t>::const_iterator island = graph.islands.find(fixup->second);
+			Reference ref = {obj.base_address + fixup->first - fn.address, fixup->second, (uint8_t) (fixup->second < 256 ? SELECTOR : FIXUP),
+					UNKNOWN, (uint8_t) (graph.islands.end() != island ? island->second : 0)};
+			if (ref.offset + ref.size() <= fn.size) {
+				references.push_back(ref);
+			}
+		}
+		size_t fixupsEnd = references.size();
+		std::vector<uint32_t>::const_iterator site = std::lower_bound(graph.displacements.begin(), graph.displacements.end(), fn.address);
+		for (; graph.displacements.end() != site && *site + 4 <= fn.end(); ++site) {
+			const uint8_t *rel32 = obj.get_data_at(*site);
+			Reference ref = {*site - fn.address, *site + 4 + read_le<int32_t>(rel32), RELATIVE, (uint8_t) (0xe8 == rel32[-1] ? FUNCTION : JUMP), 0};
+			references.push_back(ref);
+		}
+		std::inplace_merge(references.begin() + fn.first, references.begin() + fixupsEnd, references.end(), Reference::offsetLess);
+	}
+};
+
+#endif /* SRC_FUNCTION_TABLE_H_ */
@@ -0,0 +1,169 @@
+#ifndef SRC_HINTS_H_
+#define SRC_HINTS_H_
+
+#include <stdint.h>
+#include <climits>
+#include <algorithm>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "log.h"
+#include "type.h"
+#include "le/fixup_index.h"
+#include "le/object_header.h"
+
+/* Corrections of an analysis read from a --hints file, one per line with hex addresses and sizes:
+ *   force-code ADDR    traces ADDR as code even if it decodes to nops or invalid instructions
+ *   force-data ADDR    marks ADDR as data up to the next fixup target
+ *   function ADDR      traces ADDR as a function, whatever refers to it
+ *   switch ADDR        reads a jump table at ADDR up to the next fixup target
+ *   size ADDR SIZE     bounds the force-code, force-data or switch hint at ADDR, force-code then traces past jumps
+ * '#' starts a comment. Applied by Analyzer::applyHints, diffed by changed() for Analyzer::reanalyze.
+ */
+struct Hints {
+	enum Kind {
+		FORCE_CODE, FORCE_DATA, FUNCTION, SWITCH, KINDS
+	};
+
+	struct Hint {
+		uint32_t address;
+		uint32_t size;	// extent a change of the hint invalidates, see bound()
+		uint8_t kind;
+
+		bool operator<(const Hint &other) const {
+			if (address != other.address) {
+				return address < other.address;
+			}
+			return kind != other.kind ? kind < other.kind : size < other.size;
+		}
+
+		bool operator==(const Hint &other) const {
+			return address == other.address && kind == other.kind && size == other.size;
+		}
+
+		uint32_t end(void) const {
+			return address + size;
+		}
+	};
+
+	std::vector<Hint> hints;	// sorted once bound
+	std::vector<std::pair<uint32_t/*address*/, uint32_t/*end*/> > forced_code;	// merged extents of force-code hints
+
+	void load(std::istream &is, std::ostream &log) {
+		std::map<uint32_t/*address*/, uint32_t/*size*/> sizes;
+		std::string line;
+		for (size_t number = 1; std::getline(is, line); ++number) {
+			std::string content = line.substr(0, line.find('#'));
+			std::istringstream iss(content);
+			std::string name;
+			Hint hint = {0, 0, KINDS};
+			if (!(iss >> name >> std::hex >> hint.address)) {
+				// comment, blank or invalid
+			} else if (name != "size") {
+				for (hint.kind = 0; hint.kind < KINDS && name != kindName(hint.kind); ++hint.kind);
+			} else if (iss >> hint.size && hint.size > 0) {
+				sizes[hint.address] = hint.size;
+				continue;
+			}
+			if (hint.kind < KINDS) {
+				hints.push_back(hint);
+			} else if (content.find_first_not_of(" \t\r") != std::string::npos && logging(log, LOG_LOADER, LOG_WARNING)) {
+				log << "Warning: ignoring hint line " << std::dec << number << ": " << line << '\n';
+			}
+		}
+		for (std::map<uint32_t, uint32_t>::const_iterator itr = sizes.begin(); itr != sizes.end(); ++itr) {
+			bool bounded = false;
+			for (size_t n = 0; n < hints.size(); ++n) {
+				if (hints[n].address == itr->first && FUNCTION != hints[n].kind) {
+					hints[n].size = itr->second;
+					bounded = true;
+				}
+			}
+			if (!bounded && logging(log, LOG_LOADER, LOG_WARNING)) {
+				printAddress(log, itr->first, "Warning: no force-code, force-data or switch hint for the size hint at 0x") << '\n';
+			}
+		}
+	}
+
+	static const char *kindName(unsigned kind) {
+		static const char *names[] = {"force-code", "force-data", "function", "switch"};
+		return kind < KINDS ? names[kind] : "";
+	}
+
+	/* Sizes hints without a size hint: up to the next fixup target for data and tables, a byte for code.
+	 * All end in the object of their address, hints outside of objects are dropped.
+	 */
+	void bound(const AddressSet &fixupTargets, const std::vector<ObjectHeader> &objects, std::ostream &log) {
+		std::vector<Hint> bounded;
+		for (size_t n = 0; n < hints.size(); ++n) {
+			Hint hint = hints[n];
+			const ObjectHeader *obj = NULL;
+			for (size_t oi = 0; oi < objects.size(); ++oi) {
+				if (hint.address - objects[oi].base_address < objects[oi].virtual_size) {
+					obj = &objects[oi];
+				}
+			}
+			if (NULL == obj) {
+				if (logging(log, LOG_LOADER, LOG_WARNING)) {
+					printAddress(log, hint.address, "Warning: ignoring hint at unmapped address 0x") << '\n';
+				}
+				continue;
+			}
+			uint32_t limit = obj->base_address + obj->virtual_size;
+			if (0 == hint.size && (FORCE_DATA == hint.kind || SWITCH == hint.kind)) {
+				AddressSet::const_iterator next = fixupTargets.upper_bound(hint.address);
+				hint.size = (fixupTargets.end() != next ? std::min(*next, limit) : limit) - hint.address;
+			}
+			hint.size = std::min(std::max<uint32_t>(hint.size, 1), limit - hint.address);
+			bounded.push_back(hint);
+		}
+		std::sort(bounded.begin(), bounded.end());
+		bounded.erase(std::unique(bounded.begin(), bounded.end()), bounded.end());
+		hints.swap(bounded);
+		forced_code.clear();
+		for (size_t n = 0; n < hints.size(); ++n) {
+			if (FORCE_CODE != hints[n].kind) {
+				continue;
+			} else if (!forced_code.empty() && hints[n].address <= forced_code.back().second) {
+				forced_code.back().second = std::max(forced_code.back().second, hints[n].end());
+			} else {
+				forced_code.push_back(std::make_pair(hints[n].address, hints[n].end()));
+			}
+		}
+	}
+
+	/* Hints in either but not both */
+	static std::vector<Hint> changed(const Hints &a, const Hints &b) {
+		std::vector<Hint> result;
+		std::set_symmetric_difference(a.hints.begin(), a.hints.end(), b.hints.begin(), b.hints.end(), std::back_inserter(result));
+		return result;
+	}
+
+	/* End of the force-code hint containing address, 0 for none */
+	uint32_t forcedCodeEnd(uint32_t address) const {
+		std::vector<std::pair<uint32_t, uint32_t> >::const_iterator itr = std::upper_bound(forced_code.begin(), forced_code.end(), std::make_pair(address, UINT32_MAX));
+		return (forced_code.begin() != itr && address < (--itr)->second) ? itr->second : 0;
+	}
+
+	/* Whether tracing starts from a hint at address */
+	bool isRoot(uint32_t address) const {
+		std::vector<Hint>::const_iterator itr = std::lower_bound(hints.begin(), hints.end(), address, hintBefore);
+		for (; hints.end() != itr && itr->address == address; ++itr) {
+			if (FORCE_CODE == itr->kind || FUNCTION == itr->kind) {
+				return true;
+			}
+		}
+		return false;
+	}
+private:
+	static bool hintBefore(const Hint &hint, uint32_t address) {
+		return hint.address < address;
+	}
+};
+
+#endif /* SRC_HINTS_H_ */
@@ -2,6 +2,7 @@
 #define SRC_INSN_H_
 
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -10,7 +11,6 @@
 
 class Insn {
 	char string[128];
-	static int count;
 
 	int lowerCasedSpaceTrimmed(int ret, char *end) {
 		for (text = &string[0]; text < &string[textLength] + ret && isspace(*text); ++text);
@@ -23,15 +23,17 @@ class Insn {
 public:
 	static int callbackResetTypeAndText(void *stream, const char *fmt, ...) {
 		va_list list;
-		Insn * insn = (Insn *) stream;
 		va_start(list, fmt);
-		int ret = vsnprintf(&insn->string[insn->textLength], sizeof(insn->string) - 1 - insn->textLength, fmt, list);
+		int ret = appendText(stream, fmt, list);
 		va_end(list);
+		return ret;
+	}
+
+	/* What callbackResetTypeAndText does, for callbacks with arguments of their own before fmt */
+	static int appendText(void *stream, const char *fmt, va_list list) {
+		Insn * insn = (Insn *) stream;
+		int ret = vsnprintf(&insn->string[insn->textLength], sizeof(insn->string) - 1 - insn->textLength, fmt, list);
 		insn->type = MISC;
-//		if (insn->count-- > 0) {
-//			write(2, &insn->string[0], insn->textLength + ret);
-//			write(2, "\n", 1);
-//		}
 		return insn->lowerCasedSpaceTrimmed(ret, &insn->string[insn->textLength] + ret - 1);
 	}
 
@@ -44,7 +46,7 @@ public:
 		this->size = size;
 	}
 
-	void setTargetAndType(uint32_t addr, const void *data) {
+	void setTargetAndType(uint32_t addr, const void *data, bool att) {
 		bool have_target = true;
 		uint8_t data0 = ((uint8_t *) data)[0], data1 = 0;
 
@@ -105,10 +107,48 @@ public:
 			}
 			memoryAddress = address;
 		} else if (memoryAddress == 0) {
-			char * addrStr = strstr(text, "s:0x");
-			if (NULL != addrStr) {
-				memoryAddress = strtol(addrStr + 2, NULL, 16);
+			memoryAddress = absoluteOperand(text, att);
+		}
+	}
+
+	/* Address of a memory operand without base or index register. Intel syntax always prints its segment, ds:0x14c88,
+	 * AT&T syntax only an override, so 0x14c88 or %fs:0x14c88 there, and immediates as $0x10. Displacements,
+	 * 0x8(%ebp), are not addresses.
+	 */
+	static uint32_t absoluteOperand(const char *text, bool att) {
+		for (const char *hex = strstr(text, "0x"); NULL != hex; hex = strstr(hex + 2, "0x")) {
+			if (hex == text || (hex[-1] != ':' && (!att || (hex[-1] != ' ' && hex[-1] != ',')))) {
+				continue;
 			}
+			char *end;
+			uint32_t address = strtoul(hex, &end, 16);
+			if ('\0' == *end || ',' == *end) {
+				return address;
+			}
+		}
+		return 0;
+	}
+
+	/* Bytes of the memory operand of an FPU instruction, by its AT&T mnemonic suffix, or 0 for an environment or state */
+	size_t fpuOperandSize(void) const {
+		size_t length = strcspn(text, " ");
+		bool integer = length > 1 && 'i' == text[1];
+		if (length > 2 && (strncmp(text + length - 2, "cw", 2) == 0 || strncmp(text + length - 2, "sw", 2) == 0)) {
+			return 2;
+		} else if (strncmp(text, "fbld", length) == 0 || strncmp(text, "fbstp", length) == 0) {
+			return 10;
+		} else if (length > 2 && strncmp(text + length - 2, "ll", 2) == 0) {
+			return 8;
+		}
+		switch (length > 0 ? text[length - 1] : 0) {
+		case 's':
+			return integer ? 2 : 4;
+		case 'l':
+			return integer ? 4 : 8;
+		case 't':
+			return 10;
+		default:
+			return 0;
 		}
 	}
 
@@ -124,6 +164,4 @@ public:
 	size_t size;
 };
 
-int Insn::count = 10;
-
 #endif /* SRC_INSN_H_ */
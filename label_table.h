@@ -0,0 +1,196 @@
+#ifndef SRC_LABEL_TABLE_H_
+#define SRC_LABEL_TABLE_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "le/fixup_index.h"
+#include "regions.h"
+
+/* Labels of a finished analysis for printing: sorted addresses with 1 byte types and names preformatted
+ * into a single pool, so that a reference copies its name instead of formatting it. Built by assign().
+ *
+ * Printing derives labels too (CASE for switch entries, UNKNOWN for unlabeled pointers in data), hence set().
+ * Fixup targets without a label get a hidden slot up front, so that revealing them does not move the arrays.
+ */
+class LabelTable {
+	enum {
+		TYPE_MASK = 0x7f,
+		HIDDEN = 0x7f,
+		NAMED = 0x80	// name from Analyzer::symbols, kept when the type changes
+	};
+
+	std::vector<uint32_t> addresses;
+	std::vector<uint8_t> types;
+	std::vector<uint32_t> names;	// offsets of 0-terminated names in pool
+	std::string pool;
+
+	uint32_t appendName(const char *name) {
+		uint32_t offset = pool.size();
+		pool.append(name, strlen(name) + 1);
+		return offset;
+	}
+
+	static const char *defaultName(uint32_t address, Type type, char (&buffer)[32]) {
+		static const char *suffixes[] = {"unknown", "unknown", "data", "switch", "jump", "func", "case", "func"};
+		snprintf(buffer, sizeof(buffer), "_%06x_%s", address, (size_t) type < sizeof(suffixes)/sizeof(suffixes[0]) ? suffixes[type] : "unknown");
+		return buffer;
+	}
+
+	void append(uint32_t address, uint8_t type, uint32_t name) {
+		addresses.push_back(address);
+		types.push_back(type);
+		names.push_back(name);
+	}
+
+	size_t lowerBound(uint32_t address) const {
+		return std::lower_bound(addresses.begin(), addresses.end(), address) - addresses.begin();
+	}
+public:
+	static const size_t npos = (size_t) -1;
+
+	/* name as both GNU as and NASM take it for a label: letters, digits, '_' and '.', not led by a digit */
+	static std::string sanitize(const std::string &name) {
+		std::string ret(name);
+		for (size_t n = 0; n < ret.size(); ++n) {
+			if (!isalnum((uint8_t) ret[n]) && '_' != ret[n] && '.' != ret[n]) {
+				ret[n] = '_';
+			}
+		}
+		if (ret.empty() || isdigit((uint8_t) ret[0])) {
+			ret.insert(0, "_");
+		}
+		return ret;
+	}
+
+	/* Names print_code defines itself: main and the _ADDRESS_type ones of defaultName */
+	static bool reserved(const std::string &name) {
+		unsigned address;
+		char type[8];
+		int length = 0;
+		return "main" == name || (name.size() > 8 && '_' == name[7] && sscanf(name.c_str(), "_%6x_%7[a-z]%n", &address, type, &length) == 2
+				&& (size_t) length == name.size());
+	}
+
+	/* name, with _ADDRESS appended while it is reserved or used by another label, added to used */
+	static std::string unique(std::string name, uint32_t address, std::set<std::string> &used) {
+		char suffix[16];
+		snprintf(suffix, sizeof(suffix), "_%06x", address);
+		while (reserved(name) || !used.insert(name).second) {
+			name += suffix;
+		}
+		return name;
+	}
+
+	void assign(const LabelMap &labels, const AddressSet &targets, const std::map<uint32_t, std::string> &symbols) {
+		addresses.clear();
+		types.clear();
+		names.clear();
+		pool.clear();
+		addresses.reserve(labels.size() + targets.size());
+		types.reserve(labels.size() + targets.size());
+		names.reserve(labels.size() + targets.size());
+		pool.reserve(labels.size() * 16);
+
+		char buffer[32];
+		LabelMap::const_iterator label = labels.begin();
+		AddressSet::const_iterator target = targets.begin();
+		while (labels.end() != label || targets.end() != target) {
+			bool hidden = labels.end() == label || (targets.end() != target && *target < label->first);
+			uint32_t address = hidden ? *target : label->first;
+			if (targets.end() != target && *target == address) {
+				++target;
+			}
+			std::map<uint32_t, std::string>::const_iterator symbol = symbols.find(address);
+			if (symbols.end() != symbol) {
+				append(address, (hidden ? (int) HIDDEN : (int) label->second) | NAMED, appendName(symbol->second.c_str()));
+			} else if (hidden) {
+				append(address, HIDDEN, 0);
+			} else {
+				append(address, label->second, appendName(defaultName(address, label->second, buffer)));
+			}
+			if (!hidden) {
+				++label;
+			}
+		}
+	}
+
+	size_t find(uint32_t address) const {
+		size_t index = lowerBound(address);
+		return (index < addresses.size() && addresses[index] == address && HIDDEN != (types[index] & TYPE_MASK)) ? index : npos;
+	}
+
+	/* First label after address */
+	size_t upperBound(uint32_t address) const {
+		for (size_t index = std::upper_bound(addresses.begin(), addresses.end(), address) - addresses.begin(); index < addresses.size(); ++index) {
+			if (HIDDEN != (types[index] & TYPE_MASK)) {
+				return index;
+			}
+		}
+		return npos;
+	}
+
+	/* Slots, including those of fixup targets without a label, see hidden() */
+	size_t size(void) const {
+		return addresses.size();
+	}
+
+	bool hidden(size_t index) const {
+		return HIDDEN == (types[index] & TYPE_MASK);
+	}
+
+	uint32_t address(size_t index) const {
+		return addresses[index];
+	}
+
+	Type type(size_t index) const {
+		return (Type) (types[index] & TYPE_MASK);
+	}
+
+	/* Adds or retypes the label at address */
+	size_t set(uint32_t address, Type type) {
+		size_t index = lowerBound(address);
+		if (index == addresses.size() || addresses[index] != address) {
+			addresses.insert(addresses.begin() + index, address);
+			types.insert(types.begin() + index, (uint8_t) HIDDEN);
+			names.insert(names.begin() + index, 0);
+		}
+		if ((types[index] & NAMED) != 0) {
+			types[index] = type | NAMED;
+		} else if (types[index] != type) {
+			char buffer[32];
+			types[index] = type;
+			names[index] = appendName(defaultName(address, type, buffer));
+		}
+		return index;
+	}
+
+	/* Index of the label at address, added as UNKNOWN if there is none, like std::map::operator[] */
+	size_t at(uint32_t address) {
+		size_t index = find(address);
+		return npos != index ? index : set(address, UNKNOWN);
+	}
+
+	std::ostream &printName(std::ostream &os, size_t index) const {
+		return os << (pool.c_str() + names[index]);
+	}
+
+	/* Name as a label of the given type would have, unless named by a symbol */
+	std::ostream &printName(std::ostream &os, size_t index, Type as) const {
+		if ((types[index] & NAMED) != 0 || type(index) == as) {
+			return printName(os, index);
+		}
+		char buffer[32];
+		return os << defaultName(addresses[index], as, buffer);
+	}
+};
+
+#endif /* SRC_LABEL_TABLE_H_ */
@@ -0,0 +1,106 @@
+#ifndef SRC_LE_CHECKSUM_H_
+#define SRC_LE_CHECKSUM_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "../little_endian.h"
+
+/* 32-bit sum of the little endian dwords of data, zero padded to a multiple of 4.
+ * The LE format does not define the algorithm and this one is not checked against real linker output yet,
+ * so mismatches are only reported with --verify or at debug level.
+ */
+inline uint32_t checksum32(const uint8_t *data, size_t size) {
+	uint32_t sum = 0;
+	size_t n = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	for (; n + 4 <= size; n += 4) {	// GCC and Clang turn this into 16 or 32 byte vector adds at -O2
+		uint32_t word;
+		memcpy(&word, data + n, sizeof(word));
+		sum += word;
+	}
+#endif
+	for (; n + 4 <= size; n += 4) {
+		sum += read_le<uint32_t>(data + n);
+	}
+	if (n < size) {
+		uint8_t tail[4] = {0, 0, 0, 0};
+		memcpy(tail, data + n, size - n);
+		sum += read_le<uint32_t>(tail);
+	}
+	return sum;
+}
+
+/* Checksums of the header and what did not match them. A 0 checksum means none was computed. */
+struct Integrity {
+	std::vector<uint32_t> page_checksums;	// by page index, empty without a per-page checksum table
+	std::vector<uint32_t> bad_pages;	// page indices, filled by Image while loading
+	bool bad_loader_section;
+	bool bad_fixup_section;
+
+	Integrity(void) : bad_loader_section(false), bad_fixup_section(false) {}
+
+	void loadPageChecksums(std::istream &is, size_t offset, uint32_t count) {
+		is.seekg(offset);
+		page_checksums.resize(count);
+		for (uint32_t n = 0; n < count; ++n) {
+			read_le(is, page_checksums[n]);
+		}
+	}
+
+	/* Whether [offset, offset + size) of the file sums up to expected. Read in chunks of a multiple of 4 bytes,
+	 * which sum up like the whole, so that a damaged size allocates nothing beyond them.
+	 */
+	static bool verifySection(std::istream &is, size_t offset, size_t size, uint32_t expected) {
+		if (0 == expected || 0 == size) {
+			return true;
+		}
+		std::vector<uint8_t> data(std::min<size_t>(size, 64 * 1024));
+		uint32_t sum = 0;
+		is.seekg(offset);
+		for (size_t left = size; left > 0; ) {
+			size_t chunk = std::min(left, data.size());
+			if (!is.read((char *) &data.front(), chunk)) {
+				is.clear();
+				return false;
+			}
+			sum += checksum32(&data.front(), chunk);
+			left -= chunk;
+		}
+		return sum == expected;
+	}
+
+	bool hasPageChecksum(size_t index) const {
+		return index < page_checksums.size() && 0 != page_checksums[index];
+	}
+
+	/* Called for every page with a checksum, with the page as stored in the file and before fixups */
+	void verifyPage(size_t index, const uint8_t *data, size_t size) {
+		if (hasPageChecksum(index) && checksum32(data, size) != page_checksums[index]) {
+			bad_pages.push_back(index);
+		}
+	}
+
+	bool damaged(void) const {
+		return bad_loader_section || bad_fixup_section || !bad_pages.empty();
+	}
+
+	std::ostream &report(std::ostream &os) const {
+		if (bad_loader_section) {
+			os << "Warning: loader section checksum mismatch\n";
+		}
+		if (bad_fixup_section) {
+			os << "Warning: fixup section checksum mismatch\n";
+		}
+		for (size_t n = 0; n < bad_pages.size(); ++n) {	// page numbers start from 1 as defined by LE format
+			os << "Warning: checksum mismatch of page " << std::dec << bad_pages[n] + 1 << "\n";
+		}
+		return os;
+	}
+};
+
+#endif /* SRC_LE_CHECKSUM_H_ */
@@ -0,0 +1,112 @@
+#ifndef SRC_LE_ENTRY_TABLE_H_
+#define SRC_LE_ENTRY_TABLE_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../error.h"
+#include "../little_endian.h"
+#include "../log.h"
+#include "object_header.h"
+
+/* Exported entry points: entry table bundles resolved to linear addresses and named from the resident
+ * and non-resident name tables, 12 bytes per entry plus a single pool of 0-terminated names.
+ */
+struct EntryTable {
+	enum BundleType {
+		UNUSED = 0, ENTRY16 = 1, CALL_GATE = 2, ENTRY32 = 3, FORWARDER = 4
+	};
+
+	struct Entry {
+		uint32_t address;
+		uint32_t name;	// offset in names, 0 for none
+		uint16_t ordinal;
+		uint16_t object;	// index into LinearExecutable::objects
+	};
+
+	std::vector<Entry> entries;	// ascending ordinals
+	std::string names;
+
+	EntryTable(void) : names(1, '\0') {}
+
+	/* Throws on a bundle it cannot step over, keeping the entries before it */
+	void loadEntries(std::istream &is, size_t offset, const std::vector<ObjectHeader> &objects, std::ostream &log) {
+		is.seekg(offset);
+		uint16_t ordinal = 1;
+		uint8_t count, type, flags;
+		for (read_le(is, count); count != 0; read_le(is, count)) {
+			read_le(is, type);
+			if (UNUSED == type) {
+				ordinal += count;
+				continue;
+			}
+			uint16_t object, offset16, ignored;
+			uint32_t offset32;
+			read_le(is, object);
+			for (; count > 0; --count, ++ordinal) {
+				read_le(is, flags);
+				switch (type) {
+				case ENTRY16:
+					read_le(is, offset16);
+					offset32 = offset16;
+					break;
+				case CALL_GATE:
+					read_le(is, offset16);
+					read_le(is, ignored);
+					offset32 = offset16;
+					break;
+				case ENTRY32:
+					read_le(is, offset32);
+					break;
+				case FORWARDER:	// to another module, nothing to trace here
+					read_le(is, ignored);
+					read_le(is, offset32);
+					continue;
+				default:
+					throw Error() << "Invalid entry bundle type " << (int) type << " of ordinal " << ordinal;
+				}
+				if (0 == object || objects.size() < object) {
+					if (logging(log, LOG_LOADER, LOG_WARNING)) {
+						log << "Warning: ignoring entry ordinal " << std::dec << ordinal << " of invalid object " << object << '\n';
+					}
+					continue;
+				}
+				Entry entry = {objects[object - 1].base_address + offset32, 0, ordinal, (uint16_t) (object - 1)};
+				entries.push_back(entry);
+			}
+		}
+	}
+
+	/* Records of length, name and ordinal up to a 0 length. Entries keep the name they got first. */
+	void loadNames(std::istream &is, size_t offset) {
+		is.seekg(offset);
+		char buffer[256];
+		uint8_t length;
+		uint16_t ordinal;
+		for (read_le(is, length); length != 0; read_le(is, length)) {
+			if (!is.read(buffer, length)) {
+				throw Error() << "EOF";
+			}
+			read_le(is, ordinal);
+			std::vector<Entry>::iterator entry = std::lower_bound(entries.begin(), entries.end(), ordinal, ordinalLess);
+			if (entries.end() != entry && entry->ordinal == ordinal && 0 == entry->name) {	// ordinal 0 names the module
+				entry->name = names.size();
+				names.append(buffer, length).push_back('\0');
+			}
+		}
+	}
+
+	const char *name(const Entry &entry) const {
+		return names.c_str() + entry.name;
+	}
+private:
+	static bool ordinalLess(const Entry &entry, uint16_t ordinal) {
+		return entry.ordinal < ordinal;
+	}
+};
+
+#endif /* SRC_LE_ENTRY_TABLE_H_ */
@@ -0,0 +1,117 @@
+#ifndef SRC_LE_FIXUP_INDEX_H_
+#define SRC_LE_FIXUP_INDEX_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/* Sorted arrays instead of std::map/std::set: 8 resp. 4 bytes per fixup instead of a tree node,
+ * which is what dominates memory of images with millions of fixups.
+ * Filled by add() during loading and sorted by seal() before any lookup.
+ */
+struct FixupMap {
+	typedef std::pair<uint32_t/*offset*/, uint32_t/*address*/> value_type;
+	typedef std::vector<value_type>::const_iterator const_iterator;
+	typedef const_iterator iterator;
+
+	void add(uint32_t offset, uint32_t address) {
+		entries.push_back(std::make_pair(offset, address));
+	}
+
+	/* Sorts by offset, a later fixup of the same offset wins */
+	void seal(void) {
+		std::stable_sort(entries.begin(), entries.end(), compareOffsets);
+		std::vector<value_type> unique;
+		unique.reserve(entries.size());
+		for (size_t n = 0; n < entries.size(); ++n) {
+			if (!unique.empty() && unique.back().first == entries[n].first) {
+				unique.back() = entries[n];
+			} else {
+				unique.push_back(entries[n]);
+			}
+		}
+		entries.swap(unique);
+	}
+
+	const_iterator begin(void) const {
+		return entries.begin();
+	}
+
+	const_iterator end(void) const {
+		return entries.end();
+	}
+
+	size_t size(void) const {
+		return entries.size();
+	}
+
+	bool empty(void) const {
+		return entries.empty();
+	}
+
+	const_iterator lower_bound(uint32_t offset) const {
+		return std::lower_bound(entries.begin(), entries.end(), std::make_pair(offset, 0u), compareOffsets);
+	}
+
+	const_iterator find(uint32_t offset) const {
+		const_iterator itr = lower_bound(offset);
+		return (entries.end() != itr && itr->first == offset) ? itr : entries.end();
+	}
+private:
+	std::vector<value_type> entries;
+
+	static bool compareOffsets(const value_type &a, const value_type &b) {
+		return a.first < b.first;
+	}
+};
+
+struct AddressSet {
+	typedef std::vector<uint32_t>::const_iterator const_iterator;
+	typedef const_iterator iterator;
+
+	void add(uint32_t address) {
+		addresses.push_back(address);
+	}
+
+	void seal(void) {
+		std::sort(addresses.begin(), addresses.end());
+		std::vector<uint32_t>(addresses.begin(), std::unique(addresses.begin(), addresses.end())).swap(addresses);
+	}
+
+	const_iterator begin(void) const {
+		return addresses.begin();
+	}
+
+	const_iterator end(void) const {
+		return addresses.end();
+	}
+
+	size_t size(void) const {
+		return addresses.size();
+	}
+
+	const_iterator lower_bound(uint32_t address) const {
+		return std::lower_bound(addresses.begin(), addresses.end(), address);
+	}
+
+	const_iterator upper_bound(uint32_t address) const {
+		return std::upper_bound(addresses.begin(), addresses.end(), address);
+	}
+
+	const_iterator find(uint32_t address) const {
+		const_iterator itr = lower_bound(address);
+		return (addresses.end() != itr && *itr == address) ? itr : addresses.end();
+	}
+
+	void erase(uint32_t address) {
+		std::vector<uint32_t>::iterator itr = std::lower_bound(addresses.begin(), addresses.end(), address);
+		if (addresses.end() != itr && *itr == address) {
+			addresses.erase(itr);
+		}
+	}
+private:
+	std::vector<uint32_t> addresses;
+};
+
+#endif /* SRC_LE_FIXUP_INDEX_H_ */
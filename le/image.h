@@ -1,7 +1,12 @@
 #ifndef SRC_LE_IMAGE_H_
 #define SRC_LE_IMAGE_H_
 
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <map>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "../error.h"
 #include "image_object.h"
@@ -10,30 +15,51 @@
 struct Image {
 	std::vector<ImageObject> objects;
 
-	const ImageObject &objectAt(uint32_t address) const {
+	/* Object containing address, NULL if none */
+	const ImageObject *findObject(uint32_t address) const {
 		for (size_t n = 0; n < objects.size(); ++n) {
 			const ImageObject &obj = objects[n];
 			if (obj.base_address <= address and address < obj.base_address + obj.data.size()) {
-				return obj;
+				return &obj;
 			}
 		}
+		return NULL;
+	}
+
+	const ImageObject &objectAt(uint32_t address) const {
+		const ImageObject *obj = findObject(address);
+		if (NULL != obj) {
+			return *obj;
+		}
 		throw Error() << "BUG: address out of image range: 0x" << std::setfill('0') << std::setw(6) << std::hex << std::noshowbase << address;
 	}
 
-	void loadObjectData(std::istream &is, LinearExecutable &lx, std::vector<uint8_t> &data, Header &hdr, ObjectHeader &ohdr) {
+	static void loadObjectData(std::istream &is, LinearExecutable &lx, uint8_t *data, Header &hdr, ObjectHeader &ohdr, Integrity *integrity = NULL) {
 		size_t data_off = 0, page_end = std::min<size_t>(ohdr.first_page_index + ohdr.page_count, hdr.page_count);
 		for (size_t page_idx = ohdr.first_page_index; page_idx < page_end; ++page_idx) {
-			size_t size = std::min<size_t>(ohdr.virtual_size - data_off, (page_idx + 1 < hdr.page_count) ? hdr.page_size : hdr.last_page_size);
+			size_t stored = (page_idx + 1 < hdr.page_count) ? hdr.page_size : hdr.last_page_size;
+			size_t size = std::min<size_t>(ohdr.virtual_size - data_off, stored);
 			is.seekg(lx.offsetOfPageInFile(page_idx));
-			if (!is.read((char *) &data.front() + data_off, size).good()) {
+			if (!is.read((char *) data + data_off, size).good()) {
 				throw Error() << "EOF";
 			}
+			if (NULL != integrity && integrity->hasPageChecksum(page_idx)) {
+				if (size == stored) {	/* while the page is hot in cache */
+					integrity->verifyPage(page_idx, data + data_off, size);
+				} else {	// the virtual size ends inside the page, its checksum still covers all of it
+					std::vector<uint8_t> page(stored);
+					is.seekg(lx.offsetOfPageInFile(page_idx));
+					is.read((char *) &page.front(), stored);
+					integrity->verifyPage(page_idx, &page.front(), is.gcount());
+					is.clear();
+				}
+			}
 			data_off += size;
 		}
 	}
 
-	void applyFixups(std::map<uint32_t/*offset*/, uint32_t/*address*/> &fixups, std::vector<uint8_t> &data) {
-		for (std::map<uint32_t, uint32_t>::iterator itr = fixups.begin(); itr != fixups.end(); ++itr) {
+	void applyFixups(const FixupMap &fixups, std::vector<uint8_t> &data) {
+		for (FixupMap::const_iterator itr = fixups.begin(); itr != fixups.end(); ++itr) {
 			if (itr->first + 4 >= data.size()) {
 				throw Error() << "Fixup points outside object boundaries";
 			}
@@ -46,16 +72,62 @@ struct Image {
 		}
 	}
 
-	void outputFlatMemoryDump(char const * path) {
-		std::ofstream ofs(path, std::ofstream::binary);
-		if (ofs.is_open()) {
+	/* Maps [offset, offset + size) of the dump file, aligned down to a page boundary */
+	struct MappedFileRange {
+		uint8_t *map;
+		size_t length;
+		uint8_t *data;
+
+		MappedFileRange(int fd, off_t offset, size_t size) {
+			size_t delta = offset % sysconf(_SC_PAGESIZE);
+			length = size + delta;
+			map = (uint8_t *) mmap(NULL, length, PROT_WRITE, MAP_SHARED, fd, offset - delta);
+			if (MAP_FAILED == map) {
+				throw Error() << "Failed to map dump file at offset 0x" << std::hex << offset << ": " << strerror(errno);
+			}
+			data = map + delta;
+		}
+
+		~MappedFileRange(void) {
+			munmap(map, length);
+		}
+	};
+
+	/* Writes every object at its base address into a sparse file sized to the highest object end,
+	 * so the holes between objects cost no disk. With pristineSource given, pages are re-read
+	 * from the executable instead of copied, i.e. the dump has no fixups applied.
+	 */
+	void outputFlatMemoryDump(char const *path, LinearExecutable &lx, std::istream *pristineSource = NULL) const {
+		off_t end = 0;
+		for (size_t oi = 0; oi < objects.size(); ++oi) {
+			end = std::max<off_t>(end, (off_t) objects[oi].base_address + objects[oi].data.size());
+		}
+
+		int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			throw Error() << "Error opening file: " << path << ": " << strerror(errno);
+		}
+		try {
+			if (ftruncate(fd, end) != 0) {
+				throw Error() << "Failed to resize " << path << " to 0x" << std::hex << (uint64_t) end << " bytes: " << strerror(errno);
+			}
 			for (size_t oi = 0; oi < objects.size(); ++oi) {
-				ofs.seekp(objects[oi].base_address);
-				ofs.write((const char*) &objects[oi].data.front(),
-						&objects[oi].data.back() - &objects[oi].data.front());
+				const ImageObject &obj = objects[oi];
+				if (obj.data.empty()) {
+					continue;
+				}
+				MappedFileRange range(fd, obj.base_address, obj.data.size());
+				if (NULL != pristineSource) {
+					loadObjectData(*pristineSource, lx, range.data, lx.header, lx.objects[oi]);
+				} else {
+					memcpy(range.data, &obj.data.front(), obj.data.size());
+				}
 			}
-			ofs.close();
+		} catch (...) {
+			close(fd);
+			throw;
 		}
+		close(fd);
 	}
 
 	Image(std::istream &is, LinearExecutable &lx) {
@@ -65,7 +137,9 @@ struct Image {
 			ObjectHeader &ohdr = lx.objects[oi];
 			data.clear();
 			data.resize(ohdr.virtual_size);
-			loadObjectData(is, lx, data, lx.header, ohdr);
+			if (!data.empty()) {
+				loadObjectData(is, lx, &data.front(), lx.header, ohdr, &lx.integrity);
+			}
 			applyFixups(lx.fixups[oi], data);
 			objects[oi].init(oi, ohdr.base_address, ohdr.isExecutable(), data);
 		}
@@ -9,11 +9,12 @@ struct ImageObject {
 	bool executable;
 	std::vector<uint8_t> data;
 
-	void init(size_t index_, uint32_t base_address_, bool executable_, const std::vector<uint8_t> &data_) {
+	/* takes over data_, leaving it empty */
+	void init(size_t index_, uint32_t base_address_, bool executable_, std::vector<uint8_t> &data_) {
 		index = index_;
 		base_address = base_address_;
 		executable = executable_;
-		data = data_;
+		data.swap(data_);
 	}
 
 	const uint8_t *get_data_at(uint32_t address) const {
@@ -1,10 +1,14 @@
 #ifndef LIN_EX_H
 #define LIN_EX_H
 
-#include <set>
+#include <iostream>
 #include <vector>
 
+#include "../log.h"
+#include "checksum.h"
+#include "entry_table.h"
 #include "fixup.h"
+#include "fixup_index.h"
 #include "header.h"
 #include "object_page_header.h"
 
@@ -12,9 +16,19 @@ struct LinearExecutable {
     Header header;
     std::vector<ObjectHeader> objects;
     std::vector<ObjectPageHeader> object_pages;
-    std::vector<std::map<uint32_t/*offset*/, uint32_t/*address*/> > fixups;
-    std::set<uint32_t> fixup_addresses;
+    std::vector<FixupMap> fixups;
+    AddressSet fixup_addresses;
+    EntryTable exports;
+    Integrity integrity;
     
+    size_t fixupCount() const {
+    	size_t count = 0;
+    	for (size_t n = 0; n < fixups.size(); ++n) {
+    		count += fixups[n].size();
+    	}
+    	return count;
+    }
+
     uint32_t entryPointAddress() {
     	return objects[header.eip_object_index].base_address + header.eip_offset;
     }
@@ -35,33 +49,56 @@ struct LinearExecutable {
 		}
 	}
     
-    void loadObjectFixups(std::istream &is, std::vector<uint32_t> &fixup_record_offsets, size_t table_offset, size_t oi) {
+    void loadObjectFixups(std::istream &is, std::ostream &log, std::vector<uint32_t> &fixup_record_offsets, size_t table_offset, size_t oi) {
         ObjectHeader &obj = objects[oi];
         /* print object indices starting from 1 as defined by LE format */
-        std::cerr << "Loading fixups for object " << oi + 1 << std::endl;
+        if (logging(log, LOG_LOADER, LOG_INFO)) {
+            log << "Loading fixups for object " << oi + 1 << '\n';
+        }
+        bool verbose = logging(log, LOG_LOADER, LOG_DEBUG);
         for (size_t n = obj.first_page_index; n < obj.first_page_index + obj.page_count; ++n) {
             size_t offset = table_offset + fixup_record_offsets[n];
             size_t end = table_offset + fixup_record_offsets[n + 1];
             size_t page_offset = (n - obj.first_page_index) * header.page_size;
             for (is.seekg(offset); offset < end; ) {
-            	std::cerr << "Loading fixup 0x" << offset << " at page " << std::dec << (n + 1 - obj.first_page_index)
-            			<< "/" << obj.page_count << ", offset 0x" << std::hex << page_offset << ": ";
+            	if (verbose) {
+            		log << "Loading fixup 0x" << offset << " at page " << std::dec << (n + 1 - obj.first_page_index)
+            				<< "/" << obj.page_count << ", offset 0x" << std::hex << page_offset << ": ";
+            	}
                 Fixup fixup(is, offset, objects, page_offset);
-                fixups[oi][fixup.offset] = fixup.address;
-                fixup_addresses.insert(fixup.address);
-                std::cerr << "0x" << fixup.offset << " -> 0x" << fixup.address << std::endl;
+                fixups[oi].add(fixup.offset, fixup.address);
+                fixup_addresses.add(fixup.address);
+                if (verbose) {
+                    log << "0x" << fixup.offset << " -> 0x" << fixup.address << '\n';
+                }
             }
         }
     }
     
-    void loadFixupTable(std::istream &is, std::vector<uint32_t> &fixup_record_offsets, size_t table_offset) {
+    void loadFixupTable(std::istream &is, std::ostream &log, std::vector<uint32_t> &fixup_record_offsets, size_t table_offset) {
         fixups.resize(objects.size());
         for (size_t oi = 0; oi < objects.size(); ++oi) {
-            loadObjectFixups(is, fixup_record_offsets, table_offset, oi);
+            loadObjectFixups(is, log, fixup_record_offsets, table_offset, oi);
+            fixups[oi].seal();
         }
+        fixup_addresses.seal();
     }
     
-    LinearExecutable(std::istream &is, uint32_t header_offset = 0) : header(is, header_offset) {
+    LinearExecutable(std::istream &is, std::ostream &log = std::cerr, uint32_t header_offset = 0) : header(is, header_offset) {
+        /* before parsing what they cover, so that damage is not reported as a malformed table */
+        integrity.bad_loader_section = !Integrity::verifySection(is, header_offset + header.object_table_offset, header.loader_section_size, header.loader_section_check_sum);
+        integrity.bad_fixup_section = !Integrity::verifySection(is, header_offset + header.fixup_page_table_offset, header.fixup_section_size, header.fixup_section_check_sum);
+        try {
+            load(is, log, header_offset);
+        } catch (const std::exception &e) {
+            if (integrity.bad_loader_section || integrity.bad_fixup_section) {
+                throw Error() << e.what() << " (loader or fixup section checksum mismatch)";
+            }
+            throw;
+        }
+    }
+private:
+    void load(std::istream &is, std::ostream &log, uint32_t header_offset) {
         is.seekg(header_offset + header.object_table_offset);
         loadTable(is, header.object_count, objects);
         
@@ -75,7 +112,44 @@ struct LinearExecutable {
             read_le(is, fixup_record_offsets[n]);
         }
         
-        loadFixupTable(is, fixup_record_offsets, header_offset + header.fixup_record_table_offset);
+        loadFixupTable(is, log, fixup_record_offsets, header_offset + header.fixup_record_table_offset);
+
+        if (header.per_page_check_sum_table_offset != 0) {
+            integrity.loadPageChecksums(is, header_offset + header.per_page_check_sum_table_offset, header.page_count);
+        }
+
+        if (header.entry_table_offset != 0) {
+            try {
+                exports.loadEntries(is, header_offset + header.entry_table_offset, objects, log);
+            } catch (const std::exception &e) {
+                skipDamagedTable(is, log, "entry", e);
+            }
+            try {
+                if (header.resident_name_table_offset != 0) {
+                    exports.loadNames(is, header_offset + header.resident_name_table_offset);
+                }
+            } catch (const std::exception &e) {
+                skipDamagedTable(is, log, "resident name", e);
+            }
+            try {
+                if (header.non_resident_name_table_offset != 0) {	/* relative to the file, not the header */
+                    exports.loadNames(is, header.non_resident_name_table_offset);
+                }
+            } catch (const std::exception &e) {
+                skipDamagedTable(is, log, "non-resident name", e);
+            }
+            if (logging(log, LOG_LOADER, LOG_INFO)) {
+                log << std::dec << exports.entries.size() << " exported entries\n";
+            }
+        }
+    }
+
+    /* Exports only seed tracing and name labels, so damage in their tables keeps what was read before it */
+    static void skipDamagedTable(std::istream &is, std::ostream &log, const char *table, const std::exception &e) {
+        is.clear();
+        if (logging(log, LOG_LOADER, LOG_WARNING)) {
+            log << "Warning: " << table << " table: " << e.what() << ", ignoring the rest of it\n";
+        }
     }
 };
 
@@ -0,0 +1,131 @@
+#include <cstring>
+#define PACKAGE
+
+#include "le_disasm.h"
+#include "memory_stream.h"
+#include "print.h"
+
+/* Buffers stream output and hands it over to one of the Callbacks methods, or drops it without callbacks */
+struct CallbackStreamBuf : std::streambuf {
+	typedef void (LeDisasm::Callbacks::*Sink)(const char *, size_t);
+
+	LeDisasm::Callbacks *callbacks;
+
+	CallbackStreamBuf(Sink sink_) : callbacks(NULL), sink(sink_) {
+		setp(buffer, buffer + sizeof(buffer));
+	}
+protected:
+	int overflow(int c) {
+		sync();
+		if (c != traits_type::eof()) {
+			*pptr() = c;
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	int sync(void) {
+		if (pptr() > pbase() && NULL != callbacks) {
+			(callbacks->*sink)(pbase(), pptr() - pbase());
+		}
+		setp(buffer, buffer + sizeof(buffer));
+		return 0;
+	}
+private:
+	Sink sink;
+	char buffer[4096];
+};
+
+/* Forwards Progress to Callbacks::progress and cancels it on Callbacks::cancelled */
+struct CallbackProgress : Progress::Listener {
+	LeDisasm::Callbacks *callbacks;
+	Progress *token;
+
+	CallbackProgress(void) : callbacks(NULL), token(NULL) {}
+
+	void progress(const Progress &progress) {
+		if (NULL == callbacks) {
+			return;
+		}
+		callbacks->progress(progress.phase, progress.classified_bytes, progress.executable_bytes, progress.queue_depth,
+				progress.regions_printed, progress.region_count);
+		if (callbacks->cancelled()) {
+			token->cancel();
+		}
+	}
+};
+
+struct LeDisasm::Impl {
+	CallbackStreamBuf logBuf;
+	LogConfig logConfig;
+	std::ostream log;
+	CallbackProgress progressSink;
+	Progress progress;
+	MemoryStream is;
+	LinearExecutable lx;
+	Image image;
+	Analyzer analyzer;
+
+	Impl(const uint8_t *data, size_t size, Callbacks *diagnostics) : logBuf(&Callbacks::diagnostic), log(&logBuf), progress(&progressSink, 0.1),
+			is(data, size), lx(is, setDiagnostics(diagnostics)), image(is, lx), analyzer(lx, image, log) {
+		progressSink.token = &progress;
+		analyzer.progress = &progress;
+		analyzer.run(lx);
+		analyzer.buildLabelTable(lx);	// names from exports, symbols and the index, as render() prints them
+		setDiagnostics(NULL);
+	}
+
+	std::ostream &setDiagnostics(Callbacks *callbacks) {
+		log.flush();
+		logConfig.attach(log);
+		logBuf.callbacks = callbacks;
+		progressSink.callbacks = callbacks;
+		return log;
+	}
+};
+
+LeDisasm::LeDisasm(const uint8_t *data, size_t size, Callbacks *diagnostics) : impl(new Impl(data, size, diagnostics)) {
+}
+
+LeDisasm::~LeDisasm(void) {
+	delete impl;
+}
+
+void LeDisasm::regions(Callbacks &callbacks) {
+	std::ostringstream type;
+	const RegionMap &regions = impl->analyzer.regions.regions;
+	for (RegionMap::const_iterator itr = regions.begin(); itr != regions.end(); ++itr) {
+		type.str("");
+		type << itr->second.get_type();
+		callbacks.region(itr->second.get_address(), itr->second.get_size(), type.str().c_str());
+	}
+}
+
+void LeDisasm::labels(Callbacks &callbacks) {
+	std::ostringstream name;
+	const LabelTable &labels = impl->analyzer.labels;
+	for (size_t n = 0; n < labels.size(); ++n) {
+		if (labels.hidden(n)) {
+			continue;
+		}
+		name.str("");
+		labels.printName(name, n);
+		callbacks.label(labels.address(n), name.str().c_str());
+	}
+}
+
+void LeDisasm::render(Callbacks &callbacks) {
+	CallbackStreamBuf textBuf(&Callbacks::text);
+	textBuf.callbacks = &callbacks;
+	std::ostream os(&textBuf);
+	impl->setDiagnostics(&callbacks);
+	try {
+		impl->analyzer.beginPhase("print", impl->lx);
+		print_code(os, impl->lx, impl->image, impl->analyzer);
+	} catch (...) {
+		impl->setDiagnostics(NULL);
+		throw;
+	}
+	os.flush();
+	impl->setDiagnostics(NULL);
+}
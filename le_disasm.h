@@ -0,0 +1,53 @@
+#ifndef LE_DISASM_H_
+#define LE_DISASM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Embeddable le_disasm: analyzes a linear executable held in memory and reports through callbacks.
+ * Instances are independent and may be used from different threads at the same time,
+ * a single instance must not be shared between threads without locking.
+ */
+class LeDisasm {
+public:
+	struct Callbacks {
+		virtual ~Callbacks(void) {}
+
+		/** type is one of "unknown", "code", "data", "switch" */
+		virtual void region(uint32_t address, uint32_t size, const char *type) {}
+
+		/** name as rendered, e.g. "_012345_func" */
+		virtual void label(uint32_t address, const char *name) {}
+
+		/** chunk of the rendered AT&T assembly, not necessarily ending at a line boundary */
+		virtual void text(const char *text, size_t length) {}
+
+		/** analyzer diagnostics, written to stderr by the command line tool */
+		virtual void diagnostic(const char *text, size_t length) {}
+
+		/** about every 0.1 s and at the start of each phase while analyzing or rendering,
+		 * region_count and regions_printed are 0 until rendering starts */
+		virtual void progress(const char *phase, uint64_t classified_bytes, uint64_t executable_bytes, uint64_t queued,
+				uint64_t regions_printed, uint64_t region_count) {}
+
+		/** asked along with progress, true makes the constructor or render throw and the instance unusable */
+		virtual bool cancelled(void) { return false; }
+	};
+
+	/** Loads and analyzes data, which is not accessed afterwards. Throws std::exception on malformed input or when cancelled. */
+	LeDisasm(const uint8_t *data, size_t size, Callbacks *diagnostics = NULL);
+	~LeDisasm(void);
+
+	void regions(Callbacks &callbacks);
+	void labels(Callbacks &callbacks);
+	/** Renders the assembly. Diagnostics go to the same callbacks. */
+	void render(Callbacks &callbacks);
+private:
+	LeDisasm(const LeDisasm &);
+	LeDisasm &operator=(const LeDisasm &);
+
+	struct Impl;
+	Impl *impl;
+};
+
+#endif /* LE_DISASM_H_ */
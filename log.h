@@ -0,0 +1,167 @@
+#ifndef SRC_LOG_H_
+#define SRC_LOG_H_
+
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+enum LogCategory {
+	LOG_LOADER,	// header, object and fixup tables
+	LOG_TRACE,	// Analyzer
+	LOG_REGIONS,	// Regions splits and merges
+	LOG_PRINT,	// printing and serving
+	LOG_CATEGORY_COUNT
+};
+
+enum LogLevel {
+	LOG_ERROR,
+	LOG_WARNING,
+	LOG_INFO,
+	LOG_DEBUG	// a line per fixup, scheduled address, split or merge
+};
+
+/* Verbosity per category of a diagnostic stream, see attach(). Streams without one log everything, with one
+ * debug lines are left to --log.
+ */
+struct LogConfig {
+	LogLevel levels[LOG_CATEGORY_COUNT];
+
+	LogConfig(LogLevel level = LOG_INFO) {
+		std::fill(levels, levels + LOG_CATEGORY_COUNT, level);
+	}
+
+	/* "LEVEL" for all categories and/or comma separated "CATEGORY:LEVEL" items, false on unknown names */
+	bool parse(const std::string &spec) {
+		static const char *categories[LOG_CATEGORY_COUNT] = {"loader", "trace", "regions", "print"};
+		static const char *levelNames[] = {"error", "warning", "info", "debug"};
+		std::istringstream is(spec);
+		for (std::string item; std::getline(is, item, ','); ) {
+			size_t colon = item.find(':');
+			std::string level = std::string::npos == colon ? item : item.substr(colon + 1);
+			const char **name = std::find(levelNames, levelNames + sizeof(levelNames)/sizeof(levelNames[0]), level);
+			if (levelNames + sizeof(levelNames)/sizeof(levelNames[0]) == name) {
+				return false;
+			}
+			if (std::string::npos == colon) {
+				std::fill(levels, levels + LOG_CATEGORY_COUNT, (LogLevel) (name - levelNames));
+				continue;
+			}
+			const char **category = std::find(categories, categories + LOG_CATEGORY_COUNT, item.substr(0, colon));
+			if (categories + LOG_CATEGORY_COUNT == category) {
+				return false;
+			}
+			levels[category - categories] = (LogLevel) (name - levelNames);
+		}
+		return true;
+	}
+
+	void attach(std::ostream &log) {
+		log.pword(index()) = this;
+	}
+
+	static int index(void) {
+		static int index = std::ios_base::xalloc();
+		return index;
+	}
+};
+
+/* Whether log takes messages of category at level, checked before formatting one */
+inline bool logging(std::ostream &log, LogCategory category, LogLevel level) {
+	const LogConfig *config = (const LogConfig *) log.pword(LogConfig::index());
+	return NULL == config || level <= config->levels[category];
+}
+
+/* File descriptor sink writing whole buffers instead of a syscall per line */
+class LogFileBuf : public std::streambuf {
+	int fd;
+	char buffer[64 * 1024];
+protected:
+	int overflow(int c) {
+		sync();
+		if (c != traits_type::eof()) {
+			*pptr() = c;
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	int sync(void) {
+		for (const char *ptr = pbase(); ptr < pptr(); ) {
+			ssize_t size = write(fd, ptr, pptr() - ptr);
+			if (size <= 0 && EINTR != errno) {
+				break;
+			}
+			ptr += std::max<ssize_t>(size, 0);
+		}
+		setp(buffer, buffer + sizeof(buffer));
+		return 0;
+	}
+public:
+	explicit LogFileBuf(int fd_) : fd(fd_) {
+		setp(buffer, buffer + sizeof(buffer));
+	}
+
+	~LogFileBuf() {
+		sync();
+	}
+};
+
+/* Keeps only the last bytes written, for dump() when something goes wrong. The ring is the put area, so
+ * writes only leave the inline path when it wraps. Not locked: only the thread running the analysis
+ * writes the log. The progress listener runs on it from Progress::poll, the signal handler only sets the
+ * cancellation flag and the n-gram decoding threads report errors through their chunks.
+ */
+class LogRingBuf : public std::streambuf {
+	std::vector<char> ring;
+	bool wrapped;
+protected:
+	int overflow(int c) {
+		setp(&ring[0], &ring[0] + ring.size());
+		wrapped = true;
+		if (c != traits_type::eof()) {
+			*pptr() = c;
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+public:
+	explicit LogRingBuf(size_t size) : ring(std::max<size_t>(size, 1)), wrapped(false) {
+		setp(&ring[0], &ring[0] + ring.size());
+	}
+
+	/* Writes the kept bytes from the first complete line on */
+	void dump(std::ostream &os) const {
+		size_t head = pptr() - &ring[0];
+		std::vector<char>::const_iterator start = ring.begin();
+		if (wrapped) {
+			start = std::find(ring.begin() + head, ring.end(), '\n');
+			if (ring.end() != start) {
+				os.write(&*start + 1, ring.end() - start - 1);
+				start = ring.begin();
+			} else {	// the line started before the oldest byte kept
+				start = std::min(std::find(ring.begin(), ring.begin() + head, '\n') + 1, ring.begin() + head);
+			}
+		}
+		os.write(&*start, ring.begin() + head - start);
+	}
+};
+
+/* Ties a stream to the log for the scope, so that its output follows what the log buffered */
+struct LogTie {
+	std::ostream &os;
+	std::ostream *previous;
+
+	LogTie(std::ostream &os_, std::ostream &log) : os(os_), previous(os_.tie(&log)) {}
+
+	~LogTie() {
+		os.tie(previous);
+	}
+};
+
+#endif /* SRC_LOG_H_ */
@@ -1,35 +1,426 @@
+#include <signal.h>
 #include <fstream>
 #include <cstring>
 #define PACKAGE
 
-#include "print.h"
+#include "analysis_state.h"
+#include "function_index.h"
+#include "ngram_index.h"
+#include "server.h"
+
+/* Status line every period on stderr, enabled by --progress */
+struct ProgressLine : Progress::Listener {
+	void progress(const Progress &progress) {
+		std::cerr << std::dec << "Progress: " << progress.phase << ", " << progress.classified_bytes << "/" << progress.executable_bytes
+				<< " executable bytes classified, " << progress.queue_depth << " queued";
+		if (progress.region_count > 0) {
+			std::cerr << ", " << progress.regions_printed << "/" << progress.region_count << " regions printed";
+		}
+		std::cerr << "\n";
+	}
+};
+
+/* Analyzes the titles of the "EXE [SYMBOLS]" lines of list and merges their functions into the index at path */
+static void buildIndex(const char *path, const char *listPath, bool superset, const EntropyClassifier *entropy, std::ostream &log) {
+	std::ifstream list(listPath);
+	if (!list.is_open()) {
+		throw Error() << "Error opening file: " << listPath;
+	}
+	std::vector<FunctionIndex::Entry> added;
+	std::string line;
+	while (std::getline(list, line)) {
+		std::istringstream iss(line.substr(0, line.find('#')));
+		std::string exe, symbolsPath;
+		if (!(iss >> exe)) {
+			continue;
+		}
+		iss >> symbolsPath;
+		std::ifstream is(exe.c_str());
+		if (!is.is_open()) {
+			throw Error() << "Error opening file: " << exe;
+		}
+		LinearExecutable lx(is, log);
+		Image image(is, lx);
+		Analyzer analyzer(lx, image, log);
+		analyzer.superset = superset;
+		analyzer.entropy = entropy;
+		if (!symbolsPath.empty()) {
+			std::ifstream symbols(symbolsPath.c_str());
+			if (!symbols.is_open()) {
+				throw Error() << "Error opening file: " << symbolsPath;
+			}
+			analyzer.loadSymbols(symbols);
+		}
+		TraceGraph graph;
+		analyzer.graph = &graph;
+		analyzer.run(lx);
+		FunctionTable table;
+		table.collect(analyzer.regions, graph, lx, image);
+		size_t before = added.size();
+		FunctionIndex::collect(added, table, analyzer.symbols, exe);
+		if (logging(log, LOG_LOADER, LOG_INFO)) {
+			log << std::dec << "Indexed " << added.size() - before << " function(s) of " << exe << "\n";
+		}
+	}
+	size_t total = FunctionIndex::merge(path, added);
+	if (logging(log, LOG_LOADER, LOG_INFO)) {
+		log << std::dec << "Index " << path << " holds " << total << " function(s)\n";
+	}
+}
+
+static Progress *signalled = NULL;
+static volatile sig_atomic_t cancelSignal = 0;	// the one cancelRun got, for the exit status
+
+/* First SIGINT or SIGTERM stops the run at the next region, a second one kills as usual */
+static void cancelRun(int signo) {
+	cancelSignal = signo;
+	signalled->cancel();
+}
 
 int main(int argc, char **argv) {
-	if (argc < 2) {
+	bool pristineDump = false;
+	bool printStats = false;
+	bool profileDecodes = false;
+	bool verify = false;
+	bool superset = false;
+	EntropyClassifier entropy;
+	bool skipByEntropy = false;
+	unsigned long memoryBudgetMiB = 0;
+	unsigned long logRingKiB = 0;
+	double progressPeriod = 0;
+	LogConfig logConfig;
+	const char *statsJsonPath = NULL;
+	const char *socketPath = NULL;
+	const char *symbolsPath = NULL;
+	const char *hintsPath = NULL;
+	const char *statePath = NULL;
+	const char *baselinePath = NULL;
+	const char *diffPath = NULL;
+	const char *indexPath = NULL;
+	const char *buildIndexPath = NULL;
+	std::string ngramsPath;
+	bool ngrams = false;
+	const char *searchPath = NULL;
+	bool nasm = false;
+	Slice slice;
+	int argi = 1;
+	for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; ++argi) {
+		if (strcmp(argv[argi], "--no-fixups") == 0) {
+			pristineDump = true;
+		} else if (strcmp(argv[argi], "--decode-profile") == 0) {
+			profileDecodes = true;
+		} else if (strcmp(argv[argi], "--stacktrace") == 0) {
+			Error::stackTraces() = true;
+		} else if (strcmp(argv[argi], "--entropy") == 0) {
+			skipByEntropy = true;
+		} else if (strncmp(argv[argi], "--entropy=", strlen("--entropy=")) == 0) {
+			if (!entropy.parse(argv[argi] + strlen("--entropy="))) {
+				std::cerr << "Invalid entropy thresholds: " << argv[argi] << "\n";
+				return 1;
+			}
+			skipByEntropy = true;
+		} else if (strcmp(argv[argi], "--superset") == 0) {
+			superset = true;
+		} else if (strcmp(argv[argi], "--verify") == 0) {
+			verify = true;
+		} else if (strncmp(argv[argi], "--symbols=", strlen("--symbols=")) == 0) {
+			symbolsPath = argv[argi] + strlen("--symbols=");
+		} else if (strncmp(argv[argi], "--hints=", strlen("--hints=")) == 0) {
+			hintsPath = argv[argi] + strlen("--hints=");
+		} else if (strncmp(argv[argi], "--state=", strlen("--state=")) == 0) {
+			statePath = argv[argi] + strlen("--state=");
+		} else if (strncmp(argv[argi], "--baseline=", strlen("--baseline=")) == 0) {
+			baselinePath = argv[argi] + strlen("--baseline=");
+		} else if (strncmp(argv[argi], "--diff=", strlen("--diff=")) == 0) {
+			diffPath = argv[argi] + strlen("--diff=");
+		} else if (strncmp(argv[argi], "--index=", strlen("--index=")) == 0) {
+			indexPath = argv[argi] + strlen("--index=");
+		} else if (strncmp(argv[argi], "--build-index=", strlen("--build-index=")) == 0) {
+			buildIndexPath = argv[argi] + strlen("--build-index=");
+		} else if (strcmp(argv[argi], "--ngrams") == 0) {
+			ngrams = true;
+		} else if (strncmp(argv[argi], "--ngrams=", strlen("--ngrams=")) == 0) {
+			ngrams = true;
+			ngramsPath = argv[argi] + strlen("--ngrams=");
+		} else if (strncmp(argv[argi], "--search=", strlen("--search=")) == 0) {
+			searchPath = argv[argi] + strlen("--search=");
+		} else if (strncmp(argv[argi], "--syntax=", strlen("--syntax=")) == 0) {
+			const char *syntax = argv[argi] + strlen("--syntax=");
+			if (strcmp(syntax, "nasm") != 0 && strcmp(syntax, "att") != 0) {
+				std::cerr << "Unknown syntax: " << syntax << "\n";
+				return 1;
+			}
+			nasm = strcmp(syntax, "nasm") == 0;
+		} else if (strncmp(argv[argi], "--serve=", strlen("--serve=")) == 0) {
+			socketPath = argv[argi] + strlen("--serve=");
+		} else if (strncmp(argv[argi], "--from=", strlen("--from=")) == 0) {
+			slice.from = strtoul(argv[argi] + strlen("--from="), NULL, 16);
+		} else if (strncmp(argv[argi], "--to=", strlen("--to=")) == 0) {
+			slice.to = strtoul(argv[argi] + strlen("--to="), NULL, 16);
+		} else if (strncmp(argv[argi], "--function=", strlen("--function=")) == 0) {
+			slice.functions.push_back(strtoul(argv[argi] + strlen("--function="), NULL, 16));
+		} else if (strncmp(argv[argi], "--depth=", strlen("--depth=")) == 0) {
+			slice.max_depth = strtoul(argv[argi] + strlen("--depth="), NULL, 10);
+		} else if (strncmp(argv[argi], "--memory-budget=", strlen("--memory-budget=")) == 0) {
+			memoryBudgetMiB = strtoul(argv[argi] + strlen("--memory-budget="), NULL, 10);
+		} else if (strncmp(argv[argi], "--log=", strlen("--log=")) == 0) {
+			if (!logConfig.parse(argv[argi] + strlen("--log="))) {
+				std::cerr << "Unknown log category or level: " << argv[argi] << "\n";
+				return 1;
+			}
+		} else if (strncmp(argv[argi], "--log-ring=", strlen("--log-ring=")) == 0) {
+			logRingKiB = strtoul(argv[argi] + strlen("--log-ring="), NULL, 10);
+		} else if (strcmp(argv[argi], "--progress") == 0) {
+			progressPeriod = 1;
+		} else if (strncmp(argv[argi], "--progress=", strlen("--progress=")) == 0) {
+			progressPeriod = strtod(argv[argi] + strlen("--progress="), NULL);
+		} else if (strcmp(argv[argi], "--stats") == 0) {
+			printStats = true;
+		} else if (strncmp(argv[argi], "--stats-json=", strlen("--stats-json=")) == 0) {
+			statsJsonPath = argv[argi] + strlen("--stats-json=");
+		} else {
+			std::cerr << "Unknown option: " << argv[argi] << "\n";
+			return 1;
+		}
+	}
+	if ((NULL != statePath || NULL != baselinePath) && slice.enabled()) {
+		std::cerr << "--state and --baseline cannot be combined with --from, --to or --function\n";
+		return 1;
+	} else if (slice.max_depth != UINT_MAX && !slice.enabled()) {
+		std::cerr << "--depth needs --from, --to or --function\n";
+		return 1;
+	} else if (NULL != diffPath && NULL == baselinePath) {
+		std::cerr << "--diff needs --baseline\n";
+		return 1;
+	} else if (ngrams && ngramsPath.empty() && NULL == statePath) {
+		std::cerr << "--ngrams needs --state or a FILE\n";
+		return 1;
+	}
+	if (ngrams && ngramsPath.empty()) {
+		ngramsPath = std::string(statePath) + ".ngrams";
+	}
+	if (argc - argi < 1) {
 		std::cerr << "Usage: " << argv[0] << " [main.exe]\n";
-		std::cerr << "To dump flat linear executable image to a bin file: " << argv[0] << " [main.exe] [dump.bin]\n";
+		std::cerr << "To dump flat linear executable image to a bin file: " << argv[0] << " [--no-fixups] [main.exe] [dump.bin]\n";
+		std::cerr << "Per-phase timing: --stats prints a table to stderr, --stats-json=FILE writes it as JSON\n";
+		std::cerr << "Repeated instruction decodes: --decode-profile prints per address and call site counts to stderr\n";
+		std::cerr << "To print the stack trace of every error: --stacktrace\n";
+		std::cerr << "To name labels: --symbols=FILE with \"ADDR NAME\" lines, hex addresses\n";
+		std::cerr << "To correct the analysis: --hints=FILE with \"force-code|force-data|function|switch ADDR\" and \"size ADDR SIZE\" lines, hex\n";
+		std::cerr << "To save the analysis and only reanalyze what edited hints affect on the next run: --state=FILE\n";
+		std::cerr << "To take unchanged functions over from the --state of a previous build: --baseline=FILE, --diff=FILE lists changed, added and removed functions\n";
+		std::cerr << "To name functions found in an index of a corpus: --index=FILE, built or extended by " << argv[0] << " --build-index=FILE LIST with \"EXE [SYMBOLS]\" lines\n";
+		std::cerr << "To index instructions by mnemonic and operand classes: --ngrams[=FILE], STATE.ngrams next to --state=STATE by default\n";
+		std::cerr << "To list where instructions like \"in $0x60,%al; test\" follow each other: " << argv[0] << " --search=FILE QUERY, mem, addr and $imm match operands of any such value\n";
+		std::cerr << "To reject files whose page or section checksums do not match before analyzing them: --verify\n";
+		std::cerr << "To report exceeding a peak memory use: --memory-budget=MIB\n";
+		std::cerr << "To mark executable pages as data before tracing when their byte entropy is at or outside LOW and HIGH bits/byte (1,7.5): --entropy[=LOW,HIGH]\n";
+		std::cerr << "To turn likely code that tracing left unknown into code by superset disassembly: --superset\n";
+		std::cerr << "To print NASM instead of GNU as AT&T syntax: --syntax=nasm\n";
+		std::cerr << "To choose diagnostics: --log=LEVEL and/or --log=CATEGORY:LEVEL,... with loader, trace, regions, print categories and error, warning, info (default), debug levels\n";
+		std::cerr << "To keep only the last diagnostics in memory and print them on error: --log-ring=KIB\n";
+		std::cerr << "To print a status line every SECONDS (1 by default): --progress[=SECONDS], with which SIGINT stops a run at the next region\n";
+		std::cerr << "To analyze and print a slice only: --from=ADDR --to=ADDR and/or --function=ADDR (repeatable) with --depth=CALLS, hex addresses\n";
+		std::cerr << "To answer region/label/disasm/xrefs queries instead of printing: " << argv[0] << " --serve=SOCKET [main.exe]\n";
 		return 1;
 	}
+	LogFileBuf stderrBuf(2);
+	LogRingBuf ringBuf(logRingKiB * 1024);
+	std::ostream log(logRingKiB > 0 ? (std::streambuf *) &ringBuf : &stderrBuf);
+	logConfig.attach(log);
+	LogTie tie(std::cerr, log);
+	ProgressLine progressLine;
+	Progress progress(progressPeriod > 0 ? &progressLine : NULL, progressPeriod);
+	struct sigaction cancelAction, previousInt, previousTerm;
+	if (progressPeriod > 0) {
+		signalled = &progress;
+		memset(&cancelAction, 0, sizeof(cancelAction));
+		cancelAction.sa_handler = cancelRun;
+		cancelAction.sa_flags = SA_RESETHAND;
+		sigaction(SIGINT, &cancelAction, &previousInt);
+		sigaction(SIGTERM, &cancelAction, &previousTerm);
+	}
 	try {
-		std::ifstream is(argv[1]);
+		if (NULL != searchPath) {
+			NgramIndex index;
+			if (!index.open(searchPath)) {
+				throw Error() << "Error opening file: " << searchPath;
+			}
+			std::vector<uint32_t> found;
+			index.search(argv[argi], found);
+			for (size_t n = 0; n < found.size(); ++n) {
+				printAddress(std::cout, found[n]) << '\n';
+			}
+			return 0;
+		}
+		if (NULL != buildIndexPath) {
+			buildIndex(buildIndexPath, argv[argi], superset, skipByEntropy ? &entropy : NULL, log);
+			return 0;
+		}
+		std::ifstream is(argv[argi]);
 		if(!is.is_open()) {
-			std::cerr << "Error opening file: " << argv[1];
+			std::cerr << "Error opening file: " << argv[argi];
 			return 1;
 		}
 
-		LinearExecutable lx(is);
+		Stats stats;
+		stats.begin("load", Stats::Counters());
+		LinearExecutable lx(is, log);
+		if (memoryBudgetMiB > 0) {
+			uint64_t objectBytes = 0;
+			for (size_t oi = 0; oi < lx.objects.size(); ++oi) {
+				objectBytes += lx.objects[oi].virtual_size;
+			}
+			if ((objectBytes >> 20) >= memoryBudgetMiB) {
+				std::cerr << std::dec << "Warning: object data alone takes " << (objectBytes >> 20) << " MiB of the " << memoryBudgetMiB << " MiB memory budget\n";
+			}
+		}
 		Image image(is, lx);
+		if (lx.integrity.damaged()) {
+			if (verify || logging(log, LOG_LOADER, LOG_DEBUG)) {	// see checksum32
+				lx.integrity.report(log);
+			}
+			if (verify) {
+				log.flush();
+				std::cerr << "Damaged file: " << argv[argi] << "\n";
+				return 1;
+			}
+		}
 
-		if(argc >= 3) {
-			std::cerr << "Dump flat linear executable image to " << argv[2] << "\n";
-			image.outputFlatMemoryDump(argv[2]);
+		if(argc - argi >= 2) {
+			std::cerr << "Dump flat linear executable image to " << argv[argi + 1] << "\n";
+			image.outputFlatMemoryDump(argv[argi + 1], lx, pristineDump ? &is : NULL);
 		}
 
-		Analyzer analyzer(lx, image);
+		Analyzer analyzer(lx, image, log);
+		analyzer.slice = slice;
+		analyzer.progress = &progress;
+		analyzer.superset = superset;
+		if (skipByEntropy) {
+			analyzer.entropy = &entropy;
+		}
+		if (NULL != symbolsPath) {
+			std::ifstream symbols(symbolsPath);
+			if (!symbols.is_open()) {
+				throw Error() << "Error opening file: " << symbolsPath;
+			}
+			analyzer.loadSymbols(symbols);
+		}
+		Hints hints;
+		if (NULL != hintsPath) {
+			std::ifstream file(hintsPath);
+			if (!file.is_open()) {
+				throw Error() << "Error opening file: " << hintsPath;
+			}
+			hints.load(file, log);
+		}
+		hints.bound(lx.fixup_addresses, lx.objects, log);
+		if (NULL != hintsPath || NULL != statePath) {
+			analyzer.hints = &hints;
+		}
+		FunctionIndex index;
+		if (NULL != indexPath && !index.open(indexPath)) {
+			throw Error() << "Error opening file: " << indexPath;
+		}
+		TraceGraph graph;
+		if (NULL != statePath || NULL != indexPath) {
+			analyzer.graph = &graph;
+		}
+		stats.end(analyzer.counters(lx));
+		if (printStats || NULL != statsJsonPath || memoryBudgetMiB > 0) {
+			analyzer.stats = &stats;
+		}
+		DecodeProfile profile;
+		if (profileDecodes) {
+			analyzer.disasm.profile = &profile;
+		}
 
-		analyzer.run(lx);
-		print_code(lx, image, analyzer);
+		Hints previous;
+		bool cached = false;
+		if (NULL != statePath) {
+			analyzer.beginPhase("load state", lx);
+			cached = AnalysisState::load(statePath, analyzer, lx, graph, previous);
+		}
+		Baseline baseline(lx.fixups);
+		if (NULL != baselinePath && !cached) {
+			analyzer.beginPhase("load baseline", lx);
+			if (AnalysisState::loadBaseline(baselinePath, analyzer, baseline)) {
+				analyzer.baseline = &baseline;
+			}
+		}
+		std::vector<Hints::Hint> changed = Hints::changed(previous, hints);
+		if (!cached) {
+			analyzer.run(lx);
+		} else if (!changed.empty()) {
+			analyzer.reanalyze(lx, changed);
+		}
+		if (NULL != analyzer.baseline) {
+			std::ofstream diff;
+			if (NULL != diffPath) {
+				diff.open(diffPath);
+				if (!diff.is_open()) {
+					throw Error() << "Error opening file: " << diffPath;
+				}
+			}
+			baseline.report(analyzer.regions, lx, log, NULL != diffPath ? &diff : NULL);
+		}
+		if (NULL != indexPath) {
+			analyzer.beginPhase("index lookup", lx);
+			FunctionTable table;
+			table.collect(analyzer.regions, graph, lx, image);
+			index.label(table, analyzer.symbols, log);
+		}
+		if (ngrams && (!cached || !changed.empty() || access(ngramsPath.c_str(), F_OK) != 0)) {
+			analyzer.beginPhase("ngram index", lx);
+			size_t count = NgramIndex::build(ngramsPath.c_str(), analyzer.regions, image);
+			if (logging(log, LOG_TRACE, LOG_INFO)) {
+				log << std::dec << "Indexed " << count << " instruction(s) in " << ngramsPath << "\n";
+			}
+		}
+		if (NULL != statePath && (!cached || !changed.empty())) {
+			analyzer.beginPhase("save state", lx);
+			AnalysisState::save(statePath, analyzer, lx, graph, hints);
+		}
+		if (NULL != socketPath) {
+			analyzer.endPhase(lx);
+			if (progressPeriod > 0) {
+				sigaction(SIGINT, &previousInt, NULL);
+				sigaction(SIGTERM, &previousTerm, NULL);
+			}
+			QueryServer server(lx, image, analyzer);
+			server.serve(socketPath);
+			return 0;
+		}
+		analyzer.beginPhase("print", lx);
+		if (nasm) {
+			print_code<NasmSyntax>(std::cout, lx, image, analyzer);
+		} else {
+			print_code<AttSyntax>(std::cout, lx, image, analyzer);
+		}
+		analyzer.endPhase(lx);
+
+		if (profileDecodes) {
+			profile.printReport(std::cerr);
+		}
+		if (printStats) {
+			stats.printTable(std::cerr);
+		}
+		if (NULL != statsJsonPath) {
+			std::ofstream json(statsJsonPath);
+			stats.printJson(json, argv[argi]);
+		}
+		if (memoryBudgetMiB > 0 && !stats.checkBudget(std::cerr, memoryBudgetMiB * 1024)) {
+			return 1;
+		}
 	} catch (const std::exception &e) {
+		log.flush();
+		if (logRingKiB > 0) {
+			ringBuf.dump(std::cerr);
+		}
 		std::cerr << std::dec << e.what() << std::endl;
+		if (progress.isCancelled()) {
+			return 128 + (0 != cancelSignal ? cancelSignal : SIGINT);
+		}
+		return 1;
 	}
 }
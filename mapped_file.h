@@ -0,0 +1,84 @@
+#ifndef SRC_MAPPED_FILE_H_
+#define SRC_MAPPED_FILE_H_
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "error.h"
+
+/* Read-only mapping of an index file, so that lookups read only the pages they touch */
+class MappedFile {
+	const uint8_t *bytes;
+	size_t length;
+
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+public:
+	MappedFile(void) : bytes(NULL), length(0) {}
+
+	~MappedFile(void) {
+		close();
+	}
+
+	/* False if there is no file at path, an empty one maps to no data */
+	bool open(const char *path) {
+		close();
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) {
+			if (ENOENT == errno) {
+				return false;
+			}
+			throw Error() << "Error opening file: " << path << ": " << strerror(errno);
+		}
+		struct stat st;
+		void *mapped = NULL;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			mapped = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		}
+		::close(fd);
+		if (MAP_FAILED == mapped) {
+			throw Error() << "Cannot map " << path << ": " << strerror(errno);
+		}
+		bytes = (const uint8_t *) mapped;
+		length = NULL != mapped ? st.st_size : 0;
+		return true;
+	}
+
+	void close(void) {
+		if (NULL != bytes) {
+			munmap((void *) bytes, length);
+		}
+		bytes = NULL;
+		length = 0;
+	}
+
+	const uint8_t *data(void) const {
+		return bytes;
+	}
+
+	size_t size(void) const {
+		return length;
+	}
+
+	/* Writes buffer to a temporary file renamed over path, so that readers never map a partial one */
+	static void write(const char *path, const std::vector<uint8_t> &buffer) {
+		std::string temporary = std::string(path) + ".tmp";
+		std::ofstream os(temporary.c_str(), std::ios::binary | std::ios::trunc);
+		if (!os.write((const char *) &buffer.front(), buffer.size()) || (os.close(), !os)) {
+			throw Error() << "Cannot write " << temporary;
+		}
+		if (rename(temporary.c_str(), path) != 0) {
+			throw Error() << "Cannot rename " << temporary << " to " << path << ": " << strerror(errno);
+		}
+	}
+};
+
+#endif /* SRC_MAPPED_FILE_H_ */
@@ -0,0 +1,37 @@
+#ifndef SRC_MEMORY_STREAM_H_
+#define SRC_MEMORY_STREAM_H_
+
+#include <stdint.h>
+#include <istream>
+#include <streambuf>
+
+/* Seekable read-only stream over a caller-owned buffer, lets LinearExecutable and Image load from memory */
+struct MemoryStreamBuf : std::streambuf {
+	MemoryStreamBuf(const uint8_t *data, size_t size) {
+		char *begin = (char *) data;
+		setg(begin, begin, begin + size);
+	}
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in) {
+		char *base = dir == std::ios_base::beg ? eback() : dir == std::ios_base::cur ? gptr() : egptr();
+		return seekpos(base + off - eback(), which);
+	}
+
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) {
+		if ((which & std::ios_base::in) == 0 || pos < 0 || pos > egptr() - eback()) {
+			return pos_type(off_type(-1));
+		}
+		setg(eback(), eback() + pos, egptr());
+		return pos;
+	}
+};
+
+struct MemoryStream : std::istream {
+	MemoryStream(const uint8_t *data, size_t size) : std::istream(NULL), buf(data, size) {
+		rdbuf(&buf);
+	}
+private:
+	MemoryStreamBuf buf;
+};
+
+#endif /* SRC_MEMORY_STREAM_H_ */
@@ -0,0 +1,445 @@
+#ifndef SRC_NGRAM_INDEX_H_
+#define SRC_NGRAM_INDEX_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dis_info.h"
+#include "little_endian.h"
+#include "mapped_file.h"
+#include "regions.h"
+#include "le/image.h"
+
+/* Instructions of the CODE regions of an analysis as tokens of their mnemonic and operand classes, with
+ * postings of the instructions each token and each run of 2 or 3 tokens starts at, written by --ngrams
+ * and searched by --search without decoding or analyzing anything:
+ *   header: "LENGRAMS", version, instruction, token, gram and posting counts, string pool size
+ *   instructions: address, token with RUN set where addresses skip bytes that are not code
+ *   tokens: name, token of its mnemonic alone, sorted by name
+ *   grams: key (64 bits), first posting, posting count, sorted by key
+ *   postings: instruction indexes by gram
+ *   string pool: 0-terminated token names
+ * with 32 bit little endian fields unless noted.
+ *
+ * Operand classes keep registers and immediates up to 0xff, like ports and interrupt numbers, so a token
+ * reads "int $0x31", "in $0x60,%al", "mov mem,%eax", "call addr" or "$imm" for larger immediates.
+ */
+class NgramIndex {
+	enum {
+		VERSION = 1,
+		HEADER = 32,
+		INSTRUCTION = 8,
+		TOKEN = 8,
+		GRAM = 16,
+		RUN = 0x80000000u,
+		MAX_GRAM = 3,
+		MAX_THREADS = 8
+	};
+
+	MappedFile file;
+	uint32_t instructionCount, tokenCount, gramCount, postingCount, poolSize;
+	const uint8_t *instructions, *tokens, *grams, *postings;
+	const char *pool;
+
+	/* Instructions of consecutive CODE regions, decoded by one thread with names of its own */
+	struct Chunk {
+		std::vector<const Region *> regions;
+		Image *image;
+		std::vector<uint32_t> addresses;
+		std::vector<uint32_t> tokens;	// into names, RUN set where addresses skip
+		uint32_t end;	// of the last instruction
+		std::vector<std::string> names;
+		std::vector<std::string> mnemonics;	// by name
+		std::map<std::string, uint32_t> ids;
+		std::string error;
+		pthread_t thread;
+		bool started;
+	};
+
+	static const char *magic(void) {
+		return "LENGRAMS";
+	}
+
+	static void *decodeChunk(void *arg) {
+		Chunk &chunk = *(Chunk *) arg;
+		try {
+			DisInfo disasm;	// libopcodes itself is serialized by DisInfo
+			Insn inst;
+			for (size_t n = 0; n < chunk.regions.size(); ++n) {
+				const Region &reg = *chunk.regions[n];
+				const ImageObject *obj = chunk.image->findObject(reg.get_address());
+				for (uint32_t addr = reg.get_address(); NULL != obj && addr < reg.get_end_address(); addr += inst.size) {
+					disasm.disassemble(addr, obj->get_data_at(addr), reg.get_end_address() - addr, inst);
+					if (0 == inst.size) {
+						break;
+					}
+					size_t mnemonic;
+					std::string name = normalize(inst.text, mnemonic);
+					std::map<std::string, uint32_t>::iterator id = chunk.ids.find(name);
+					if (chunk.ids.end() == id) {
+						id = chunk.ids.insert(std::make_pair(name, (uint32_t) chunk.names.size())).first;
+						chunk.names.push_back(name);
+						chunk.mnemonics.push_back(name.substr(0, mnemonic));
+					}
+					chunk.addresses.push_back(addr);
+					chunk.tokens.push_back(id->second | (addr != chunk.end || chunk.tokens.empty() ? (uint32_t) RUN : 0));
+					chunk.end = addr + inst.size;
+				}
+			}
+		} catch (const std::exception &e) {
+			chunk.error = e.what();
+		}
+		return NULL;
+	}
+
+	static uint64_t gramKey(const uint32_t *ids, size_t n) {
+		uint64_t value = 14695981039346656037ULL ^ n;
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t byte = 0; byte < 4; ++byte) {
+				value = (value ^ ((ids[i] >> (byte * 8)) & 0xff)) * 1099511628211ULL;
+			}
+		}
+		return value;
+	}
+
+	static bool notAlnum(char c) {
+		return !isalnum((uint8_t) c);
+	}
+
+	static bool branch(const std::string &mnemonic) {
+		return 'j' == mnemonic[0] || 0 == mnemonic.compare(0, 4, "call") || 0 == mnemonic.compare(0, 4, "loop");
+	}
+
+	static std::string operandClass(const std::string &op, bool target) {
+		char buffer[16];
+		if ('*' == op[0]) {
+			return "*" + operandClass(op.substr(1), false);
+		} else if ('$' == op[0] && op != "$imm") {
+			unsigned long value = strtoul(op.c_str() + 1, NULL, 0);
+			if (value > 0xff) {
+				return "$imm";
+			}
+			snprintf(buffer, sizeof(buffer), "$0x%lx", value);
+			return buffer;
+		} else if (op.find_first_of("(:") != std::string::npos) {
+			return "mem";
+		} else if (isdigit((uint8_t) op[0]) || '-' == op[0]) {
+			return target ? "addr" : "mem";
+		}
+		return op;	// register, or class names in queries
+	}
+
+	const uint8_t *instruction(size_t n) const {
+		return instructions + n * INSTRUCTION;
+	}
+
+	const uint8_t *token(size_t n) const {
+		return tokens + n * TOKEN;
+	}
+
+	uint32_t tokenAt(size_t n) const {
+		return read_le<uint32_t>(instruction(n) + 4) & ~(uint32_t) RUN;
+	}
+
+	/* Token named name, tokenCount for none */
+	uint32_t findToken(const std::string &name) const {
+		uint32_t low = 0, high = tokenCount;
+		while (low < high) {
+			uint32_t mid = low + (high - low) / 2;
+			uint32_t offset = read_le<uint32_t>(token(mid));
+			if (strcmp(offset < poolSize ? pool + offset : "", name.c_str()) < 0) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+		uint32_t offset = low < tokenCount ? read_le<uint32_t>(token(low)) : poolSize;
+		return offset < poolSize && name == pool + offset ? low : tokenCount;
+	}
+
+	/* First posting and count of the gram of n ids */
+	std::pair<uint32_t, uint32_t> findGram(const uint32_t *ids, size_t n) const {
+		uint64_t key = gramKey(ids, n);
+		uint32_t low = 0, high = gramCount;
+		while (low < high) {
+			uint32_t mid = low + (high - low) / 2;
+			if (read_le<uint64_t>(grams + (size_t) mid * GRAM) < key) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+		if (low == gramCount || read_le<uint64_t>(grams + (size_t) low * GRAM) != key) {
+			return std::make_pair(0u, 0u);
+		}
+		return std::make_pair(read_le<uint32_t>(grams + (size_t) low * GRAM + 8), read_le<uint32_t>(grams + (size_t) low * GRAM + 12));
+	}
+public:
+	NgramIndex(void) : instructionCount(0), tokenCount(0), gramCount(0), postingCount(0), poolSize(0),
+			instructions(NULL), tokens(NULL), grams(NULL), postings(NULL), pool(NULL) {}
+
+	/* "mnemonic classes" of the AT&T text of an instruction or of a query, the mnemonic alone without
+	 * operands. Words after the first one of a letter then letters and digits are prefixed mnemonics.
+	 */
+	static std::string normalize(const char *text, size_t &mnemonicLength) {
+		std::string mnemonic, operands;
+		const char *p = text;
+		for (;;) {
+			for (; isspace((uint8_t) *p); ++p);
+			const char *end = p;
+			for (; '\0' != *end && !isspace((uint8_t) *end); ++end);
+			std::string word(p, end);
+			if (p == end || (!mnemonic.empty() && (word == "mem" || word == "addr" || !isalpha((uint8_t) word[0])
+					|| std::find_if(word.begin(), word.end(), notAlnum) != word.end()))) {
+				break;
+			}
+			mnemonic += (mnemonic.empty() ? "" : " ") + word;
+			p = end;
+		}
+		std::string rest;
+		for (; '\0' != *p && '#' != *p; ++p) {
+			if (!isspace((uint8_t) *p)) {
+				rest += tolower((uint8_t) *p);
+			}
+		}
+		for (size_t i = 0; i < mnemonic.size(); ++i) {
+			mnemonic[i] = tolower((uint8_t) mnemonic[i]);
+		}
+		int depth = 0;
+		size_t start = 0;
+		for (size_t i = 0; i <= rest.size(); ++i) {
+			if (i == rest.size() || (',' == rest[i] && 0 == depth)) {
+				if (i > start) {
+					operands += (operands.empty() ? "" : ",") + operandClass(rest.substr(start, i - start), !mnemonic.empty() && branch(mnemonic));
+				}
+				start = i + 1;
+			} else {
+				depth += '(' == rest[i] ? 1 : ')' == rest[i] ? -1 : 0;
+			}
+		}
+		mnemonicLength = mnemonic.size();
+		return operands.empty() ? mnemonic : mnemonic + " " + operands;
+	}
+
+	/* Decodes the CODE regions on up to MAX_THREADS threads and writes the index to path, returns its instruction count */
+	static size_t build(const char *path, const Regions &regions, Image &image) {
+		std::vector<const Region *> code;
+		uint64_t bytes = 0;
+		for (RegionMap::const_iterator itr = regions.regions.begin(); itr != regions.regions.end(); ++itr) {
+			if (CODE == itr->second.get_type()) {
+				code.push_back(&itr->second);
+				bytes += itr->second.get_size();
+			}
+		}
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		std::vector<Chunk> chunks(std::max<long>(1, std::min<long>(MAX_THREADS, cpus)));
+		uint64_t done = 0;
+		for (size_t n = 0; n < code.size(); done += code[n]->get_size(), ++n) {	// consecutive regions of about even sizes
+			chunks[done * chunks.size() / bytes].regions.push_back(code[n]);
+		}
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			chunks[c].image = &image;
+			chunks[c].end = 0;
+			chunks[c].started = pthread_create(&chunks[c].thread, NULL, decodeChunk, &chunks[c]) == 0;
+			if (!chunks[c].started) {
+				decodeChunk(&chunks[c]);
+			}
+		}
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			if (chunks[c].started) {
+				pthread_join(chunks[c].thread, NULL);
+			}
+		}
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			if (!chunks[c].error.empty()) {
+				throw Error() << chunks[c].error;
+			}
+		}
+		return write(path, chunks);
+	}
+
+	/* Maps the file at path, false if there is none */
+	bool open(const char *path) {
+		if (!file.open(path)) {
+			return false;
+		}
+		const uint8_t *data = file.data();
+		if (file.size() < HEADER || memcmp(data, magic(), 8) != 0 || read_le<uint32_t>(data + 8) != VERSION) {
+			throw Error() << "Invalid n-gram index: " << path;
+		}
+		instructionCount = read_le<uint32_t>(data + 12);
+		tokenCount = read_le<uint32_t>(data + 16);
+		gramCount = read_le<uint32_t>(data + 20);
+		postingCount = read_le<uint32_t>(data + 24);
+		poolSize = read_le<uint32_t>(data + 28);
+		if (file.size() != HEADER + (uint64_t) instructionCount * INSTRUCTION + (uint64_t) tokenCount * TOKEN
+				+ (uint64_t) gramCount * GRAM + (uint64_t) postingCount * sizeof(uint32_t) + poolSize
+				|| (poolSize > 0 && 0 != data[file.size() - 1])) {
+			throw Error() << "Invalid n-gram index: " << path;
+		}
+		instructions = data + HEADER;
+		tokens = instructions + (size_t) instructionCount * INSTRUCTION;
+		grams = tokens + (size_t) tokenCount * TOKEN;
+		postings = grams + (size_t) gramCount * GRAM;
+		pool = (const char *) postings + (size_t) postingCount * sizeof(uint32_t);
+		return true;
+	}
+
+	/* Addresses where the instructions of query, separated by ';', follow each other in code. An
+	 * instruction without operands matches any operands.
+	 */
+	void search(const std::string &query, std::vector<uint32_t> &found) const {
+		std::vector<uint32_t> ids;
+		std::vector<bool> exact;
+		for (size_t start = 0; start <= query.size(); ) {
+			size_t end = std::min(query.find(';', start), query.size());
+			size_t mnemonic;
+			std::string name = normalize(query.substr(start, end - start).c_str(), mnemonic);
+			start = end + 1;
+			if (name.empty()) {
+				continue;
+			}
+			ids.push_back(findToken(name));
+			exact.push_back(mnemonic < name.size());
+			if (tokenCount == ids.back()) {
+				return;
+			}
+		}
+		if (ids.empty()) {
+			return;
+		}
+		/* postings of the shortest list of any element or run of exact elements, shifted by where it starts */
+		std::pair<uint32_t, uint32_t> seed(0, UINT32_MAX);
+		size_t shift = 0;
+		for (size_t i = 0; i < ids.size(); ++i) {
+			for (size_t n = 1; n <= MAX_GRAM && i + n <= ids.size() && (1 == n || (exact[i] && exact[i + n - 1])); ++n) {
+				std::pair<uint32_t, uint32_t> list = findGram(&ids[i], n);
+				if (list.second < seed.second) {
+					seed = list;
+					shift = i;
+				}
+			}
+		}
+		for (uint32_t p = seed.first; p < seed.first + seed.second && p < postingCount; ++p) {
+			uint32_t at = read_le<uint32_t>(postings + (size_t) p * sizeof(uint32_t));
+			if (at < shift || at - shift + ids.size() > instructionCount) {
+				continue;
+			}
+			size_t first = at - shift, i = 0;
+			for (; i < ids.size(); ++i) {
+				uint32_t tok = tokenAt(first + i);
+				if ((i > 0 && (read_le<uint32_t>(instruction(first + i) + 4) & RUN)) || tok >= tokenCount
+						|| (exact[i] ? tok != ids[i] : read_le<uint32_t>(token(tok) + 4) != ids[i])) {
+					break;
+				}
+			}
+			if (i == ids.size()) {
+				found.push_back(read_le<uint32_t>(instruction(first)));
+			}
+		}
+	}
+private:
+	static size_t write(const char *path, std::vector<Chunk> &chunks) {
+		std::map<std::string, std::string> mnemonicOf;	// names of all chunks and their mnemonics
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			for (size_t n = 0; n < chunks[c].names.size(); ++n) {
+				mnemonicOf[chunks[c].names[n]] = chunks[c].mnemonics[n];
+				mnemonicOf.insert(std::make_pair(chunks[c].mnemonics[n], chunks[c].mnemonics[n]));
+			}
+		}
+		std::map<std::string, uint32_t> ids;	// numbered once sorted
+		std::string strings;
+		std::vector<uint32_t> mnemonics, names;
+		for (std::map<std::string, std::string>::const_iterator itr = mnemonicOf.begin(); itr != mnemonicOf.end(); ++itr) {
+			ids.insert(ids.end(), std::make_pair(itr->first, (uint32_t) names.size()));
+			names.push_back(strings.size());
+			strings.append(itr->first.c_str(), itr->first.size() + 1);
+		}
+		for (std::map<std::string, std::string>::const_iterator itr = mnemonicOf.begin(); itr != mnemonicOf.end(); ++itr) {
+			mnemonics.push_back(ids[itr->second]);
+		}
+
+		std::vector<uint32_t> addresses, stream;
+		uint32_t end = 0;
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			std::vector<uint32_t> remap(chunks[c].names.size());
+			for (size_t n = 0; n < remap.size(); ++n) {
+				remap[n] = ids[chunks[c].names[n]];
+			}
+			for (size_t n = 0; n < chunks[c].tokens.size(); ++n) {
+				bool run = 0 != (chunks[c].tokens[n] & RUN) && (0 != n || stream.empty() || chunks[c].addresses[n] != end);
+				addresses.push_back(chunks[c].addresses[n]);
+				stream.push_back(remap[chunks[c].tokens[n] & ~(uint32_t) RUN] | (run ? (uint32_t) RUN : 0));
+			}
+			if (!chunks[c].tokens.empty()) {
+				end = chunks[c].end;
+			}
+			std::vector<uint32_t>().swap(chunks[c].addresses);
+			std::vector<uint32_t>().swap(chunks[c].tokens);
+		}
+
+		std::vector<std::pair<uint64_t, uint32_t> > keyed;	// key, instruction
+		keyed.reserve(stream.size() * 4);
+		uint32_t gram[MAX_GRAM];
+		for (size_t n = 0; n < stream.size(); ++n) {
+			size_t length = 0;
+			for (; length < MAX_GRAM && n + length < stream.size() && (0 == length || 0 == (stream[n + length] & RUN)); ++length) {
+				gram[length] = stream[n + length] & ~(uint32_t) RUN;
+				keyed.push_back(std::make_pair(gramKey(gram, length + 1), (uint32_t) n));
+			}
+			if (mnemonics[gram[0]] != gram[0]) {
+				keyed.push_back(std::make_pair(gramKey(&mnemonics[gram[0]], 1), (uint32_t) n));
+			}
+		}
+		std::sort(keyed.begin(), keyed.end());
+
+		size_t gramTotal = 0;
+		for (size_t n = 0; n < keyed.size(); ++n) {
+			gramTotal += 0 == n || keyed[n].first != keyed[n - 1].first;
+		}
+		std::vector<uint8_t> buffer(HEADER + addresses.size() * INSTRUCTION + ids.size() * TOKEN + gramTotal * GRAM + keyed.size() * sizeof(uint32_t));
+		memcpy(&buffer[0], magic(), 8);
+		write_le<uint32_t>(&buffer[8], VERSION);
+		write_le<uint32_t>(&buffer[12], addresses.size());
+		write_le<uint32_t>(&buffer[16], ids.size());
+		write_le<uint32_t>(&buffer[20], gramTotal);
+		write_le<uint32_t>(&buffer[24], keyed.size());
+		write_le<uint32_t>(&buffer[28], strings.size());
+		uint8_t *at = &buffer[HEADER];
+		for (size_t n = 0; n < addresses.size(); ++n, at += INSTRUCTION) {
+			write_le<uint32_t>(at, addresses[n]);
+			write_le<uint32_t>(at + 4, stream[n]);
+		}
+		for (size_t n = 0; n < names.size(); ++n, at += TOKEN) {
+			write_le<uint32_t>(at, names[n]);
+			write_le<uint32_t>(at + 4, mnemonics[n]);
+		}
+		uint8_t *posting = at + gramTotal * GRAM;
+		for (size_t n = 0; n < keyed.size(); ++n, posting += sizeof(uint32_t)) {
+			if (0 == n || keyed[n].first != keyed[n - 1].first) {
+				size_t end = n;
+				for (; end < keyed.size() && keyed[end].first == keyed[n].first; ++end);
+				write_le<uint64_t>(at, keyed[n].first);
+				write_le<uint32_t>(at + 8, n);
+				write_le<uint32_t>(at + 12, end - n);
+				at += GRAM;
+			}
+			write_le<uint32_t>(posting, keyed[n].second);
+		}
+		buffer.insert(buffer.end(), strings.begin(), strings.end());
+		MappedFile::write(path, buffer);
+		return addresses.size();
+	}
+};
+
+#endif /* SRC_NGRAM_INDEX_H_ */
@@ -4,7 +4,9 @@
 #include "analyzer.h"
 #include "le/image.h"
 #include "print_data.h"
+#include "syntax.h"
 
+template<class Syntax>
 static std::string replace_addresses_with_labels(const std::string &str, Image &img, LinearExecutable &lx, Analyzer &anal) {
 	std::ostringstream oss;
 	size_t n, start;
@@ -40,16 +42,16 @@ static std::string replace_addresses_with_labels(const std::string &str, Image &
 
 		addr_str = str.substr(start, n - start);
 		addr = strtol(addr_str.c_str(), NULL, 16);
-		std::map<uint32_t, Type>::const_iterator lab = anal.regions.labelTypes.find(addr);
+		size_t lab = anal.labels.find(addr);
 		if (prefix_symbol != '-' /* && prefix_symbol != '$' */
-				&& anal.regions.labelTypes.end() != lab) {
-			printTypedAddress(oss, addr, lab->second);
+				&& LabelTable::npos != lab) {
+			anal.labels.printName(oss, lab);
 		} else {
 			printAddress(oss, addr);
 
 			if (lx.fixup_addresses.find(addr) != lx.fixup_addresses.end()) {
 				img.objectAt(addr);	// throws
-				comment = " /* Warning: address points to a valid object/reloc, but no label found */";
+				comment = std::string(" ") + Syntax::commentStart() + "Warning: address points to a valid object/reloc, but no label found" + Syntax::commentEnd();
 			}
 		}
 
@@ -66,101 +68,98 @@ static std::string replace_addresses_with_labels(const std::string &str, Image &
 	return oss.str();
 }
 
-static void print_instruction(Insn &inst, Image &img, LinearExecutable &lx, Analyzer &anal) {
+template<class Syntax>
+static void print_instruction(std::ostream &os, Insn &inst, Image &img, LinearExecutable &lx, Analyzer &anal) {
 	std::string str;
-	std::string::size_type n;
 
-	str = replace_addresses_with_labels(inst.text, img, lx, anal);
+	str = replace_addresses_with_labels<Syntax>(inst.text, img, lx, anal);
 
-	n = str.find("(287 only)");
-	if (n != std::string::npos) {
-		std::cout << "\t\t/* " << str << " -- ignored */\n";
+	if (!Syntax::fix(str)) {
+		os << "\t\t" << Syntax::commentStart() << str << " -- ignored" << Syntax::commentEnd() << "\n";
 		return;
 	}
+	os << "\t\t" << str;
 
-	/* Work around buggy libopcodes */
-	if (str == "lar    %cx,%ecx") {
-		str = "lar    %ecx,%ecx";
-	} else if (str == "lsl    %ax,%eax") {
-		str = "lsl    %eax,%eax";
-	} else if (str == "lea    0x000000(%eax,%eiz,1),%eax") {
-		str = "lea    0x000000(%eax),%eax";
-	} else if (str == "lea    0x000000(%edx,%eiz,1),%edx") {
-		str = "lea    0x000000(%edx),%edx";	// https://www.technovelty.org/arch/the-quickest-way-to-do-nothing.html
-	}
-	std::cout << "\t\t" << str;
-
-	if (str == "data16" or str == "data32") {
-		std::cout << " ";
+	if (Syntax::prefix(str)) {
+		os << " ";
 	} else {
-		std::cout << "\n";
+		os << "\n";
 	}
 }
 
-static void printCodeTypeRegion(const Region &reg, const ImageObject &obj, LinearExecutable &lx, Image &img, Analyzer &anal) {
-	DisInfo disasm;
+template<class Syntax>
+static void printCodeTypeRegion(std::ostream &os, const Region &reg, const ImageObject &obj, LinearExecutable &lx, Image &img, Analyzer &anal) {
+	DisInfo &disasm = anal.disasm;
 	Insn inst;
 	for (uint32_t addr = reg.get_address(); addr < reg.get_end_address();) {
-		std::map<uint32_t, Type>::iterator type = anal.regions.labelTypes.find(addr);
-		if (anal.regions.labelTypes.end() != type) {
-//			if (CASE == type->second) {	// newline makes case not be part of function
-				std::cout << std::endl;
+		size_t label = anal.labels.find(addr);
+		if (LabelTable::npos != label) {
+//			if (CASE == anal.labels.type(label)) {	// newline makes case not be part of function
+				os << std::endl;
 //			}
-			printLabel(addr, type->second) << std::endl;
+			printLabel(os, anal.labels, label, anal.labels.type(label)) << std::endl;
 		}
 
-		disasm.disassemble(addr, obj.get_data_at(addr), reg.get_end_address() - addr, inst);
-		if (anal.regions.labelTypes.end() == type && inst.size > 1) {	// hack for corrupted libraries
-			type = anal.regions.labelTypes.find(addr + inst.size / 2);
-			if (anal.regions.labelTypes.end() != type) {
-				printLabel(addr + inst.size / 2, type->second) << "\t/* WARNING: instructions around this label are incorrect, generated just to workaround corrupted library */" << std::endl;
+		disasm.disassemble<Syntax::decode>(addr, obj.get_data_at(addr), reg.get_end_address() - addr, inst, DecodeProfile::PRINT);
+		if (LabelTable::npos == label && inst.size > 1) {	// hack for corrupted libraries
+			label = anal.labels.find(addr + inst.size / 2);
+			if (LabelTable::npos != label) {
+				printLabel(os, anal.labels, label, anal.labels.type(label)) << "\t" << Syntax::commentStart()
+						<< "WARNING: instructions around this label are incorrect, generated just to workaround corrupted library" << Syntax::commentEnd() << std::endl;
 			}
 		}
-		print_instruction(inst, img, lx, anal);
+		print_instruction<Syntax>(os, inst, img, lx, anal);
 		addr += inst.size;
 	}
 }
 
-
-static void printSwitchTypeRegion(const Region &reg, const ImageObject &obj, LinearExecutable &lx, Image &img, Analyzer &anal) {
+template<class Syntax>
+static void printSwitchTypeRegion(std::ostream &os, const Region &reg, const ImageObject &obj, LinearExecutable &lx, Image &img, Analyzer &anal) {
 	uint32_t func_addr, addr = reg.get_address();
 
 	/* TODO: limit by relocs */
-	printLabel(addr, anal.regions.labelTypes[addr]) << std::endl;
-	std::map<uint32_t, Type>::iterator next_label = anal.regions.labelTypes.upper_bound(addr);
+	LabelTable &labels = anal.labels;
+	size_t label = labels.at(addr);
+	printLabel(os, labels, label, labels.type(label)) << std::endl;
+	label = labels.upperBound(addr);
+	uint32_t next_label = LabelTable::npos != label ? labels.address(label) : 0;	// an address, indices move on insertion
 
 	while (addr < reg.get_end_address()) {
-		if (anal.regions.labelTypes.end() != next_label and addr == next_label->first) {
-			printLabel(addr, next_label->second) << std::endl;
-			next_label = anal.regions.labelTypes.upper_bound(addr);
+		if (LabelTable::npos != label and addr == next_label) {
+			label = labels.find(addr);
+			printLabel(os, labels, label, labels.type(label)) << std::endl;
+			label = labels.upperBound(addr);
+			next_label = LabelTable::npos != label ? labels.address(label) : 0;
 		}
 
 		func_addr = read_le<uint32_t>(obj.get_data_at(addr));
 
 		if (func_addr != 0) {
 			if (addr < func_addr) {
-				anal.regions.labelTypes[func_addr] = CASE;
+				labels.set(func_addr, CASE);
 			}
-			printTypedAddress(std::cout << "\t\t.long   ", func_addr, anal.regions.labelTypes[func_addr]) << std::endl;
+			labels.printName(os << Syntax::dword(), labels.at(func_addr)) << std::endl;
 		} else {
-			std::cout << "\t\t.long   0\n";
+			os << Syntax::dword() << "0\n";
 		}
 		addr += sizeof(uint32_t);
 	}
-	std::cout << std::endl;
+	os << std::endl;
 }
 
-static void print_region(const Region &reg, const ImageObject &obj, LinearExecutable &lx, Image &img, Analyzer &anal) {
-	void (*printMethods[])(const Region &, const ImageObject &, LinearExecutable &, Image &, Analyzer &) = {NULL, printCodeTypeRegion, printDataTypeRegion, printSwitchTypeRegion};
+template<class Syntax>
+static void print_region(std::ostream &os, const Region &reg, const ImageObject &obj, LinearExecutable &lx, Image &img, Analyzer &anal) {
+	void (*printMethods[])(std::ostream &, const Region &, const ImageObject &, LinearExecutable &, Image &, Analyzer &) = {NULL,
+			printCodeTypeRegion<Syntax>, printDataTypeRegion<Syntax>, printSwitchTypeRegion<Syntax>};
 	if (UNKNOWN < reg.get_type() && reg.get_type() < sizeof(printMethods)/sizeof(printMethods[0])) {
-		(*printMethods[reg.get_type()])(reg, obj, lx, img, anal);
+		(*printMethods[reg.get_type()])(os, reg, obj, lx, img, anal);
 	}
 	else {
 		/* Emit unidentified region data for reference. Hex editors like wxHexEditor
 		 * could be used to find and disassemble the rendered raw data that could
 		 * help further improve le_disasm analyzer and actual reengineering projects.
 		 */
-		std::cout << "\n\t\t/* Skipped " << std::dec << reg.size << " bytes of "
+		os << "\n\t\t" << Syntax::commentStart() << "Skipped " << std::dec << reg.size << " bytes of "
 				<< (obj.executable ? "executable " : "") << reg.type
 				<< " type data at virtual address 0x" << std::setfill('0')
 				<< std::setw(8) << std::hex << std::noshowbase
@@ -168,62 +167,125 @@ static void print_region(const Region &reg, const ImageObject &obj, LinearExecut
 		const uint8_t * data_pointer = obj.get_data_at(reg.address);
 		for (uint8_t index = 0; index < reg.size && data_pointer; ++index) {
 			if (index >= 16) {
-				std::cout << "\n\t\t * ...";
+				os << "\n\t\t" << Syntax::commentLine() << " ...";
 				break;
 			}
 			if (index % 8 == 0) {
-				std::cout << "\n\t\t *\t";
+				os << "\n\t\t" << Syntax::commentLine() << "\t";
 			}
-			std::cout << std::setfill('0') << std::setw(2) << std::hex
+			os << std::setfill('0') << std::setw(2) << std::hex
 					<< std::noshowbase << (uint32_t) data_pointer[index];
 		}
-		std::cout << "\n\t\t */" << std::endl;
+		os << "\n\t\t" << Syntax::commentEnd() << std::endl;
+	}
+}
+
+/* Prints the part of reg overlapping [from, to), widened to instruction and table entry boundaries */
+template<class Syntax>
+static void print_region_part(std::ostream &os, const Region &reg, uint32_t from, uint32_t to, LinearExecutable &lx, Image &img, Analyzer &anal) {
+	const ImageObject &obj = img.objectAt(reg.get_address());
+	uint32_t start = reg.get_address();
+	uint32_t end = std::min<uint32_t>(reg.get_end_address(), to);
+	if (CODE == reg.get_type()) {
+		Insn inst;
+		uint32_t addr = start;
+		for (; addr < end; addr += inst.size) {
+			anal.disasm.disassemble<Syntax::decode>(addr, obj.get_data_at(addr), reg.get_end_address() - addr, inst);
+			if (addr + inst.size <= from) {
+				start = addr + inst.size;
+			}
+		}
+		end = addr;
+	} else if (SWITCH == reg.get_type()) {
+		start += (std::max<uint32_t>(start, from) - start) & ~3;
+		end = std::min<uint32_t>(reg.get_end_address(), start + ((end - start + 3) & ~3));
+	} else {
+		start = std::max<uint32_t>(start, from);
+	}
+	if (start < end) {
+		print_region<Syntax>(os, Region(start, end - start, reg.get_type()), obj, lx, img, anal);
 	}
 }
 
-static void printChangedSectionType(const Region &reg, Type &section) {
-	char sections[][6] = { "bug", ".text", ".data" };
+template<class Syntax>
+static void printChangedSectionType(std::ostream &os, const Region &reg, Type &section) {
 	if (reg.get_type() == DATA) {
 		if (section != DATA) {
-			std::cout << std::endl << sections[section = DATA] << std::endl;
+			os << std::endl << Syntax::section(section = DATA) << std::endl;
 		}
 	} else {
 		if (section != CODE) {
-			std::cout << std::endl << sections[section = CODE] << std::endl;
+			os << std::endl << Syntax::section(section = CODE) << std::endl;
 		}
 	}
 }
 
-void print_code(LinearExecutable &lx, Image &img, Analyzer &anal) {
+/* In the output dialect of Syntax, AttSyntax or NasmSyntax */
+template<class Syntax>
+inline void print_code(std::ostream &os, LinearExecutable &lx, Image &img, Analyzer &anal) {
 	const Region *prev = NULL;
 	const Region *next;
 	Type section = CODE;
 
 	Regions &regions = anal.regions;
 
-	std::cerr << "Region count: " << regions.regions.size() << std::endl;
+	if (logging(anal.log, LOG_PRINT, LOG_INFO)) {
+		anal.log << "Region count: " << regions.regions.size() << '\n';
+	}
+	anal.buildLabelTable(lx);
+	if (NULL != anal.progress) {
+		anal.progress->region_count = regions.regions.size();
+		anal.progress->regions_printed = 0;
+	}
 
-	std::cout << ".code32" << std::endl;
-	std::cout << ".text" << std::endl;
-	std::cout << ".globl main" << std::endl;
-	std::cout << "main:" << std::endl;
-	printTypedAddress(std::cout << "\t\tjmp\t", lx.entryPointAddress(), FUNCTION) << std::endl;
+	os << Syntax::bits() << std::endl;
+	os << Syntax::section(CODE) << std::endl;
+	const Slice &slice = anal.slice;
+	if (!slice.enabled()) {
+		os << Syntax::global() << "main" << std::endl;
+		os << "main:" << std::endl;
+		size_t entry = anal.labels.find(lx.entryPointAddress());
+		if (LabelTable::npos != entry) {
+			anal.labels.printName(os << "\t\tjmp\t", entry, FUNCTION) << std::endl;
+		} else {
+			printTypedAddress(os << "\t\tjmp\t", lx.entryPointAddress(), FUNCTION) << std::endl;
+		}
+	}
 
-	for (std::map<uint32_t, Region>::const_iterator itr = regions.regions.begin(); itr != regions.regions.end(); ++itr) {
+	RegionMap::const_iterator itr = regions.regions.begin();
+	if (slice.hasRange()) {
+		const Region *first = regions.regionContaining(slice.from);
+		itr = regions.regions.lower_bound(NULL != first ? first->get_address() : slice.from);
+	}
+	for (; itr != regions.regions.end() && itr->first < slice.to; ++itr) {
+		if (NULL != anal.progress) {
+			++anal.progress->regions_printed;
+			anal.pollProgress();
+		}
 		const Region &reg = itr->second;
 		const ImageObject &obj = img.objectAt(reg.get_address());
 
-		printChangedSectionType(reg, section);
-
-		print_region(reg, obj, lx, img, anal);
+		if (slice.hasRange()) {
+			printChangedSectionType<Syntax>(os, reg, section);
+			print_region_part<Syntax>(os, reg, slice.from, slice.to, lx, img, anal);
+		} else if (slice.enabled()) {	/* only what the functions reach */
+			if (UNKNOWN == reg.get_type() || !obj.executable) {
+				continue;
+			}
+			printChangedSectionType<Syntax>(os, reg, section);
+			print_region<Syntax>(os, reg, obj, lx, img, anal);
+		} else {
+			printChangedSectionType<Syntax>(os, reg, section);
+			print_region<Syntax>(os, reg, obj, lx, img, anal);
+		}
 
 		assert(prev == NULL || prev->get_end_address() <= reg.get_address());
 
 		next = regions.nextRegion(reg);
 		if (next == NULL or next->get_address() > reg.get_end_address()) {
-			std::map<uint32_t, Type>::iterator type = anal.regions.labelTypes.find(reg.get_end_address());
-			if (anal.regions.labelTypes.end() != type) {
-				printLabel(reg.get_end_address(), type->second) << std::endl;
+			size_t label = anal.labels.find(reg.get_end_address());
+			if (LabelTable::npos != label) {
+				printLabel(os, anal.labels, label, anal.labels.type(label)) << std::endl;
 			}
 		}
 
@@ -231,4 +293,8 @@ void print_code(LinearExecutable &lx, Image &img, Analyzer &anal) {
 	}
 }
 
+inline void print_code(std::ostream &os, LinearExecutable &lx, Image &img, Analyzer &anal) {
+	print_code<AttSyntax>(os, lx, img, anal);
+}
+
 #endif /* SRC_PRINT_H_ */
@@ -1,14 +1,14 @@
 #ifndef PRINT_DATA_H_
 #define PRINT_DATA_H_
 
-static int getIndent(Type type) {
+static int getIndent(std::ostream &os, Type type) {
 	if (JUMP == type || CASE == type) {
 		return 1;
 	} else if (FUNCTION == type || FUNC_GUESS == type) {
-		std::cout << "\n\n";
+		os << "\n\n";
 //		print_separator();
 	} else if (SWITCH == type) {
-		std::cout << '\n';
+		os << '\n';
 	}
 	return 0;
 }
@@ -32,18 +32,18 @@ static std::ostream &printTypedAddress(std::ostream &os, uint32_t address, Type
 	}
 }
 
-std::ostream & printLabel(uint32_t address, Type type, char const *prefix = "") {
-	for (int indent = getIndent(type); indent-- > 0; std::cout << '\t');
-	printTypedAddress(std::cout << prefix, address, type) << ":";
+inline std::ostream & printLabel(std::ostream &os, const LabelTable &labels, size_t index, Type type, char const *prefix = "") {
+	for (int indent = getIndent(os, type); indent-- > 0; os << '\t');
+	labels.printName(os << prefix, index, type) << ":";
 //	TODO: if (!lab->get_name().empty()) {
-//		std::cout << "\t/* " << lab->get_address() << " */";
+//		os << "\t/* " << lab->get_address() << " */";
 //	}
-	return std::cout;
+	return os;
 }
 
 static bool data_is_address(const ImageObject &obj, uint32_t addr, size_t len, LinearExecutable &lx) {
 	if (len >= 4) {
-		const std::map<uint32_t, uint32_t> &fups = lx.fixups[obj.index];
+		const FixupMap &fups = lx.fixups[obj.index];
 		return fups.find(addr - obj.base_address) != fups.end();
 	}
 	return false;
@@ -90,38 +90,40 @@ static bool data_is_string(const ImageObject &obj, uint32_t addr, size_t len, si
 	return true;
 }
 
-static void print_escaped_string(const uint8_t *data, size_t len) {
+template<class Syntax>
+static void print_escaped_string(std::ostream &os, const uint8_t *data, size_t len) {
 	size_t n;
 
 	for (n = 0; n < len; n++) {
 		if (data[n] == '\t')
-			std::cout << "\\t";
+			os << "\\t";
 		else if (data[n] == '\r')
-			std::cout << "\\r";
+			os << "\\r";
 		else if (data[n] == '\n')
-			std::cout << "\\n";
+			os << "\\n";
 		else if (data[n] == '\\')
-			std::cout << "\\\\";
-		else if (data[n] == '"')
-			std::cout << "\\\"";
+			os << "\\\\";
+		else if (data[n] == Syntax::QUOTE)
+			os << '\\' << (char) Syntax::QUOTE;
 		else
-			std::cout << (char) data[n];
+			os << (char) data[n];
 	}
 }
 
-void completeStringQuoting(int &bytes_in_line, int resetTo = 0) {
+template<class Syntax>
+inline void completeStringQuoting(std::ostream &os, int &bytes_in_line, int resetTo = 0) {
 	if (bytes_in_line > 0) {
-		std::cout << "\"\n";
+		os << Syntax::stringEnd(false);
 		bytes_in_line = resetTo;
 	}
 }
 
-static size_t getLen(const Region &reg, const ImageObject &obj, Analyzer &anal, std::map<uint32_t/*offset*/, uint32_t/*address*/> &fups, std::map<uint32_t, uint32_t>::const_iterator &itr, uint32_t addr) {
+static size_t getLen(const Region &reg, const ImageObject &obj, Analyzer &anal, FixupMap &fups, FixupMap::const_iterator &itr, uint32_t addr) {
 	size_t len = reg.get_end_address() - addr;
 
-	std::map<uint32_t, Type>::iterator label = anal.regions.labelTypes.upper_bound(addr);
-	if (anal.regions.labelTypes.end() != label) {
-		len = std::min<size_t>(len, label->first - addr);
+	size_t label = anal.labels.upperBound(addr);
+	if (LabelTable::npos != label) {
+		len = std::min<size_t>(len, anal.labels.address(label) - addr);
 	}
 
 	while (fups.end() != itr and itr->first <= addr - obj.base_address) {
@@ -134,34 +136,30 @@ static size_t getLen(const Region &reg, const ImageObject &obj, Analyzer &anal,
 	return len;
 }
 
-static void printDataAfterFixup(const ImageObject &obj, LinearExecutable &lx, Analyzer &anal, uint32_t &addr, size_t len, int &bytes_in_line) {
+template<class Syntax>
+static void printDataAfterFixup(std::ostream &os, const ImageObject &obj, LinearExecutable &lx, Analyzer &anal, uint32_t &addr, size_t len, int &bytes_in_line) {
 	size_t size;
 	bool zt;
 	while (len > 0) {
 		if (data_is_address(obj, addr, len, lx)) {
-			completeStringQuoting(bytes_in_line);
+			completeStringQuoting<Syntax>(os, bytes_in_line);
 			uint32_t value = read_le<uint32_t>(obj.get_data_at(addr));
-			printTypedAddress(std::cout << "\t\t.long   ", value, anal.regions.labelTypes[value]) << std::endl;
+			anal.labels.printName(os << Syntax::dword(), anal.labels.at(value)) << std::endl;
 
 			addr += 4;
 			len -= 4;
 		} else if (data_is_zeros(obj, addr, len, size)) {
-			completeStringQuoting(bytes_in_line);
+			completeStringQuoting<Syntax>(os, bytes_in_line);
 
-			std::cout << "\t\t.fill   0x" << std::hex << size << std::endl;
+			Syntax::fill(os, size) << std::endl;
 			addr += size;
 			len -= size;
 		} else if (data_is_string(obj, addr, len, size, zt)) {
-			completeStringQuoting(bytes_in_line);
+			completeStringQuoting<Syntax>(os, bytes_in_line);
 
-			if (zt) {
-				std::cout << "\t\t.string \"";
-			} else {
-				std::cout << "\t\t.ascii   \"";
-			}
-			print_escaped_string(obj.get_data_at(addr), size - zt);
-
-			std::cout << "\"\n";
+			os << Syntax::string(zt);
+			print_escaped_string<Syntax>(os, obj.get_data_at(addr), size - zt);
+			os << Syntax::stringEnd(zt);
 
 			addr += size;
 			len -= size;
@@ -169,15 +167,15 @@ static void printDataAfterFixup(const ImageObject &obj, LinearExecutable &lx, An
 			char buffer[8];
 
 			if (bytes_in_line == 0)
-				std::cout << "\t\t.ascii  \"";
+				os << Syntax::bytes();
 
 			snprintf(buffer, sizeof(buffer), "\\x%02x", *obj.get_data_at(addr));
-			std::cout << buffer;
+			os << buffer;
 
 			bytes_in_line += 1;
 
 			if (bytes_in_line == 8) {
-				std::cout << "\"\n";
+				os << Syntax::stringEnd(false);
 				bytes_in_line = 0;
 			}
 
@@ -187,21 +185,22 @@ static void printDataAfterFixup(const ImageObject &obj, LinearExecutable &lx, An
 	}
 }
 
-void printDataTypeRegion(const Region &reg, const ImageObject &obj, LinearExecutable &lx, Image &img, Analyzer &anal) {
+template<class Syntax>
+inline void printDataTypeRegion(std::ostream &os, const Region &reg, const ImageObject &obj, LinearExecutable &lx, Image &img, Analyzer &anal) {
 	int bytes_in_line = 0;
 	uint32_t addr = reg.get_address();
-	std::map<uint32_t/*offset*/, uint32_t/*address*/> &fups = lx.fixups[obj.index];
-	for (std::map<uint32_t, uint32_t>::const_iterator itr = fups.begin(); addr < reg.get_end_address();) {
-		std::map<uint32_t, Type>::iterator label = anal.regions.labelTypes.find(addr);
-		if (anal.regions.labelTypes.end() != label) {
-			completeStringQuoting(bytes_in_line);
-			std::cout << std::endl;
-			printLabel(addr, DATA) /*<< stringNameFromValue(FIXME: too late to do it here, printTypedAddress() needs to do the same) */<< std::endl;
+	FixupMap &fups = lx.fixups[obj.index];
+	for (FixupMap::const_iterator itr = fups.begin(); addr < reg.get_end_address();) {
+		size_t label = anal.labels.find(addr);
+		if (LabelTable::npos != label) {
+			completeStringQuoting<Syntax>(os, bytes_in_line);
+			os << std::endl;
+			printLabel(os, anal.labels, label, DATA) /*<< stringNameFromValue(FIXME: too late to do it here, printTypedAddress() needs to do the same) */<< std::endl;
 		}
 		size_t len = getLen(reg, obj, anal, fups, itr, addr);
-		printDataAfterFixup(obj, lx, anal, addr, len, bytes_in_line);
+		printDataAfterFixup<Syntax>(os, obj, lx, anal, addr, len, bytes_in_line);
 	}
-	completeStringQuoting(bytes_in_line, bytes_in_line);
+	completeStringQuoting<Syntax>(os, bytes_in_line, bytes_in_line);
 }
 
 #endif /* PRINT_DATA_H_ */
@@ -0,0 +1,82 @@
+#ifndef SRC_PROGRESS_H_
+#define SRC_PROGRESS_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include "error.h"
+
+/* Thrown out of Analyzer::run and print_code once Progress::cancel was called */
+struct Cancelled : public Error {
+	Cancelled(void) {
+		*this << "Cancelled";
+	}
+};
+
+/* Counters of a long run and its cancellation token, polled at region granularity by Analyzer::trace_code
+ * and print_code. Enabled by --progress, see also LeDisasm::Callbacks::progress.
+ */
+class Progress {
+public:
+	struct Listener {
+		virtual ~Listener(void) {}
+
+		/** called every period and at the start of each phase */
+		virtual void progress(const Progress &progress) = 0;
+	};
+
+	const char *phase;
+	uint64_t executable_bytes;
+	uint64_t classified_bytes;	// of executable_bytes, no longer UNKNOWN
+	uint64_t queue_depth;	// code trace addresses waiting
+	uint64_t region_count;	// known once printing started
+	uint64_t regions_printed;
+
+	Progress(Listener *listener_ = NULL, double period_ = 1.0) : phase(""), executable_bytes(0), classified_bytes(0), queue_depth(0),
+			region_count(0), regions_printed(0), listener(listener_), period(period_), last_report(seconds()), polls(0), cancelled(0) {}
+
+	/* Safe to call from a signal handler or another thread: the flag is a lock-free atomic */
+	void cancel(void) {
+		__atomic_store_n(&cancelled, 1, __ATOMIC_RELAXED);
+	}
+
+	bool isCancelled(void) const {
+		return __atomic_load_n(&cancelled, __ATOMIC_RELAXED) != 0;
+	}
+
+	void beginPhase(const char *name) {
+		phase = name;
+		report();
+	}
+
+	/* Throws Cancelled if cancel() was called, notifies the listener when period elapsed */
+	void poll(void) {
+		if (isCancelled()) {
+			throw Cancelled();
+		}
+		if (NULL != listener && 0 == (++polls & 63) && seconds() - last_report >= period) {
+			report();
+		}
+	}
+
+	void report(void) {
+		last_report = seconds();
+		if (NULL != listener) {
+			listener->progress(*this);
+		}
+	}
+private:
+	Listener *listener;
+	double period;
+	double last_report;
+	unsigned polls;
+	int cancelled;
+
+	static double seconds(void) {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+};
+
+#endif /* SRC_PROGRESS_H_ */
@@ -45,7 +45,7 @@ struct Region {
 	Type type;
 };
 
-std::ostream &operator<<(std::ostream &os, Type type) {
+inline std::ostream &operator<<(std::ostream &os, Type type) {
 	switch (type) {
 	case UNKNOWN:
 		return os << "unknown";
@@ -60,7 +60,7 @@ std::ostream &operator<<(std::ostream &os, Type type) {
 	}
 }
 
-std::ostream &operator<<(std::ostream &os, const Region &reg) {	// %7s @ 0x%06x[%6d]
+inline std::ostream &operator<<(std::ostream &os, const Region &reg) {	// %7s @ 0x%06x[%6d]
 	FlagsRestorer _(os);
 	return printAddress(os << std::setw(7) << reg.get_type(), reg.get_address(), " @ 0x") << "[" << std::setw(6) << std::setfill(' ') << std::dec << reg.get_size() << "]";
 }
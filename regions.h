@@ -1,27 +1,49 @@
 #ifndef SRC_REGIONS_H_
 #define SRC_REGIONS_H_
 
+#include <algorithm>
+#include <vector>
+
+#include "arena.h"
+#include "log.h"
 #include "le/object_header.h"
 #include "region.h"
 
+typedef std::map<uint32_t, Region, std::less<uint32_t>, ArenaAllocator<std::pair<const uint32_t, Region> > > RegionMap;
+typedef std::map<uint32_t, Type, std::less<uint32_t>, ArenaAllocator<std::pair<const uint32_t, Type> > > LabelMap;
+
 struct Regions {
-	std::map<uint32_t, Region> regions;
-	std::map<uint32_t, Type> labelTypes;
+	Arena arena;	// of the whole analysis, declared first to outlive the maps
+	RegionMap regions;
+	LabelMap labelTypes;
+	uint64_t splits;
+	uint64_t merges;
+	uint64_t executable_bytes;
+	uint64_t classified_bytes;	// of executable_bytes, split out of UNKNOWN regions
+	std::vector<uint32_t> objectEnds;	// sorted, regions never merge across them
+	std::ostream &log;
 
-	Regions(std::vector<ObjectHeader> &objects) {
+	Regions(std::vector<ObjectHeader> &objects, std::ostream &log_) : regions(std::less<uint32_t>(), RegionMap::allocator_type(&arena)),
+			labelTypes(std::less<uint32_t>(), LabelMap::allocator_type(&arena)), splits(0), merges(0), executable_bytes(0), classified_bytes(0), log(log_) {
 		for (size_t n = 0; n < objects.size(); ++n) {
 			ObjectHeader &ohdr = objects[n];
 			Type type = ohdr.isExecutable() ? UNKNOWN : DATA;
-			printAddress(std::cerr, ohdr.base_address, "Creating Region(0x") << ", " << std::dec << ohdr.virtual_size << ", " << type << ")" << std::endl;
+			if (logging(log, LOG_REGIONS, LOG_INFO)) {
+				printAddress(log, ohdr.base_address, "Creating Region(0x") << ", " << std::dec << ohdr.virtual_size << ", " << type << ")\n";
+			}
 			regions[ohdr.base_address] = Region(ohdr.base_address, ohdr.virtual_size, type);
+			objectEnds.push_back(ohdr.base_address + ohdr.virtual_size);
 			if (!ohdr.isExecutable()) {
 				labelTypes[ohdr.base_address] = type;
-			}	// else no automatic label for lowest .text address
+			} else {	// no automatic label for lowest .text address
+				executable_bytes += ohdr.virtual_size;
+			}
 		}
+		std::sort(objectEnds.begin(), objectEnds.end());
 	}
 
 	Region *regionContaining(uint32_t address) {
-		std::map<uint32_t, Region>::iterator itr = regions.lower_bound(address);
+		RegionMap::iterator itr = regions.lower_bound(address);
 		if (regions.end() != itr) {
 			if (itr->first == address) {
 				return &itr->second;
@@ -40,35 +62,72 @@ struct Regions {
 		assert(parent.contains_address(reg.get_address()));
 		assert(parent.contains_address(reg.get_end_address() - 1));
 
-		FlagsRestorer _(std::cerr);
+		FlagsRestorer _(log);
+		bool verbose = logging(log, LOG_REGIONS, LOG_DEBUG);
+		++splits;
+		if (UNKNOWN == parent.get_type() && UNKNOWN != reg.get_type()) {
+			classified_bytes += reg.get_size();
+		} else if (UNKNOWN != parent.get_type() && UNKNOWN == reg.get_type()) {
+			classified_bytes -= reg.get_size();
+		}
 		Region next(reg.get_end_address(), parent.get_end_address() - reg.get_end_address(), parent.get_type());
-		std::cerr << parent << " split to ";
+		if (verbose) {
+			log << parent << " split to ";
+		}
 
 		if (reg.get_address() != parent.get_address()) {
 			parent.size = reg.get_address() - parent.get_address();
 			regions[reg.get_address()] = reg;
-			std::cerr << parent << ", " << reg;
+			if (verbose) {
+				log << parent << ", " << reg;
+			}
 		} else {
 			parent = reg;
-			std::cerr << parent;
+			if (verbose) {
+				log << parent;
+			}
 		}
 
 		if (next.size > 0) {
 			regions[reg.get_end_address()] = next;
-			std::cerr << ", " << next;
+			if (verbose) {
+				log << ", " << next;
+			}
+		}
+		if (verbose) {
+			log << '\n';
 		}
-		std::cerr << std::endl;
 
 		check_merge_regions(reg.get_address());
 	}
 
+	/* Turns [address, end) back into UNKNOWN for Analyzer::reanalyze, labels stay */
+	void unclassify(uint32_t address, uint32_t end) {
+		for (uint32_t at = address; at < end; ) {
+			Region *reg = regionContaining(at);
+			if (NULL == reg) {
+				RegionMap::iterator next = regions.upper_bound(at);
+				if (regions.end() == next) {
+					return;
+				}
+				at = next->first;
+				continue;
+			}
+			uint32_t to = std::min<size_t>(end, reg->get_end_address());
+			if (UNKNOWN != reg->get_type()) {
+				splitInsert(*reg, Region(at, to - at, UNKNOWN));
+			}
+			at = to;
+		}
+	}
+
 	Region *nextRegion(const Region &reg) {
-		std::map<uint32_t, Region>::iterator itr = regions.upper_bound(reg.get_address());
+		RegionMap::iterator itr = regions.upper_bound(reg.get_address());
 		return regions.end() != itr ? &itr->second : NULL;
 	}
 private:
 	Region *previousRegion(const Region &reg) {
-		for (std::map<uint32_t, Region>::iterator itr = regions.lower_bound(reg.get_address()); regions.begin() != itr;) {
+		for (RegionMap::iterator itr = regions.lower_bound(reg.get_address()); regions.begin() != itr;) {
 			--itr;
 			return &itr->second;
 		}
@@ -82,8 +141,12 @@ private:
 	}
 
 	Region *attemptMerge(Region *prev, Region *next) {
-		if (prev != NULL and next != NULL && prev->get_type() == next->get_type() and prev->get_end_address() == next->get_address()) {
-			std::cerr << "Combining " << *prev << " and " << *next << std::endl;
+		if (prev != NULL and next != NULL && prev->get_type() == next->get_type() and prev->get_end_address() == next->get_address()
+				and !std::binary_search(objectEnds.begin(), objectEnds.end(), prev->get_end_address())) {
+			if (logging(log, LOG_REGIONS, LOG_DEBUG)) {
+				log << "Combining " << *prev << " and " << *next << '\n';
+			}
+			++merges;
 			prev->size += next->size;
 			regions.erase(next->get_address());
 			return prev;
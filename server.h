@@ -0,0 +1,231 @@
+#ifndef SRC_SERVER_H_
+#define SRC_SERVER_H_
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "print.h"
+
+/* Answers queries about an analyzed executable over a Unix domain socket, enabled by --serve=PATH.
+ *
+ * One command per line, addresses in hex:
+ *   region ADDR        region containing ADDR: "type address size"
+ *   label ADDR         label name at ADDR
+ *   disasm FROM TO     rendered assembly of [FROM, TO)
+ *   xrefs ADDR         addresses of fixups and instructions referring to ADDR
+ *   quit               closes the connection
+ *   shutdown           stops the server
+ * Replies are "ok N" followed by N lines, or a single "error MESSAGE" line. Clients sending a line longer than
+ * MAX_LINE bytes are dropped.
+ */
+struct QueryServer {
+	enum {
+		MAX_LINE = 4096
+	};
+
+	LinearExecutable &lx;
+	Image &image;
+	Analyzer &anal;
+	std::vector<std::pair<uint32_t/*target*/, uint32_t/*source*/> > xrefs;
+
+	QueryServer(LinearExecutable &lx_, Image &image_, Analyzer &anal_) : lx(lx_), image(image_), anal(anal_), running(true) {
+		for (size_t oi = 0; oi < lx.fixups.size(); ++oi) {
+			for (FixupMap::const_iterator itr = lx.fixups[oi].begin(); itr != lx.fixups[oi].end(); ++itr) {
+				xrefs.push_back(std::make_pair(itr->second, image.objects[oi].base_address + itr->first));
+			}
+		}
+		Insn inst;
+		for (RegionMap::const_iterator itr = anal.regions.regions.begin(); itr != anal.regions.regions.end(); ++itr) {
+			const Region &reg = itr->second;
+			if (CODE != reg.get_type()) {
+				continue;
+			}
+			const ImageObject &obj = image.objectAt(reg.get_address());
+			for (uint32_t addr = reg.get_address(); addr < reg.get_end_address(); addr += inst.size) {
+				anal.disasm.disassemble(addr, obj.get_data_at(addr), reg.get_end_address() - addr, inst);
+				if (inst.memoryAddress != 0 && inst.type != Insn::MISC) {	// operands are covered by fixups
+					xrefs.push_back(std::make_pair(inst.memoryAddress, addr));
+				}
+			}
+		}
+		anal.buildLabelTable(lx);
+		std::sort(xrefs.begin(), xrefs.end());
+		xrefs.erase(std::unique(xrefs.begin(), xrefs.end()), xrefs.end());
+	}
+
+	void serve(const char *path) {
+		int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (listener < 0 || strlen(path) >= sizeof(addr.sun_path)) {
+			throw Error() << "Cannot create socket " << path;
+		}
+		strcpy(addr.sun_path, path);
+		struct stat st;
+		if (lstat(path, &st) == 0) {	// a socket left behind by an earlier run, anything else is not ours
+			if (!S_ISSOCK(st.st_mode)) {
+				close(listener);
+				throw Error() << "Cannot listen on " << path << ": not a socket";
+			}
+			unlink(path);
+		}
+		if (bind(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(listener, 16) != 0) {
+			close(listener);
+			throw Error() << "Cannot listen on " << path << ": " << strerror(errno);
+		}
+		if (logging(anal.log, LOG_PRINT, LOG_INFO)) {
+			anal.log << "Serving queries on " << path << std::endl;
+		}
+
+		std::vector<struct pollfd> fds(1);
+		std::vector<std::string> pending(1);	// incomplete input line per connection
+		fds[0].fd = listener;
+		fds[0].events = POLLIN;
+		while (running) {
+			if (poll(&fds.front(), fds.size(), -1) < 0) {
+				if (EINTR == errno) {
+					continue;
+				}
+				break;
+			}
+			for (size_t n = fds.size(); n-- > 1; ) {
+				if (fds[n].revents != 0 && !receive(fds[n].fd, pending[n])) {
+					close(fds[n].fd);
+					fds.erase(fds.begin() + n);
+					pending.erase(pending.begin() + n);
+				}
+			}
+			if ((fds[0].revents & POLLIN) != 0) {
+				struct pollfd client = {accept(listener, NULL, NULL), POLLIN, 0};
+				if (client.fd >= 0) {
+					fds.push_back(client);
+					pending.push_back(std::string());
+				}
+			}
+		}
+		for (size_t n = 0; n < fds.size(); ++n) {
+			close(fds[n].fd);
+		}
+		unlink(path);
+	}
+
+	/* Returns the reply to a single command line, false on quit */
+	bool query(const std::string &line, std::string &reply) {
+		std::istringstream is(line);
+		std::string command;
+		uint32_t from = 0, to = 0;
+		is >> command;
+		std::ostringstream os;
+		size_t lines = 0;
+		try {
+			if (command == "disasm") {
+				readAddresses(is, 2, from, to);
+			} else if (command == "region" || command == "label" || command == "xrefs") {
+				readAddresses(is, 1, from, to);
+			} else if (command == "quit" || command == "shutdown") {
+				readAddresses(is, 0, from, to);
+			}
+			if (command == "region") {
+				Region *reg = anal.regions.regionContaining(from);
+				if (NULL != reg) {
+					printAddress(os << reg->get_type() << " ", reg->get_address()) << " " << std::dec << reg->get_size() << "\n";
+					++lines;
+				}
+			} else if (command == "label") {
+				size_t label = anal.labels.find(from);
+				if (LabelTable::npos != label) {
+					anal.labels.printName(os, label) << "\n";
+					++lines;
+				}
+			} else if (command == "disasm") {
+				lines = disassemble(os, from, to);
+			} else if (command == "xrefs") {
+				std::vector<std::pair<uint32_t, uint32_t> >::const_iterator itr = std::lower_bound(xrefs.begin(), xrefs.end(), std::make_pair(from, 0u));
+				for (; xrefs.end() != itr && itr->first == from; ++itr, ++lines) {
+					printAddress(os, itr->second) << "\n";
+				}
+			} else if (command == "quit") {
+				return false;
+			} else if (command == "shutdown") {
+				running = false;
+				return false;
+			} else {
+				throw Error() << "unknown command: " << command;
+			}
+		} catch (const std::exception &e) {
+			reply = std::string("error ") + e.what() + "\n";
+			return true;
+		}
+		std::ostringstream header;
+		header << "ok " << std::dec << lines << "\n";
+		reply = header.str() + os.str();
+		return true;
+	}
+private:
+	bool running;
+
+	/* Reads count hex addresses into from and to, throws on missing, invalid or extra arguments */
+	static void readAddresses(std::istream &is, size_t count, uint32_t &from, uint32_t &to) {
+		if ((count > 0 && !(is >> std::hex >> from)) || (count > 1 && !(is >> std::hex >> to))) {
+			throw Error() << "expected " << count << " hex address(es)";
+		} else if (!(is >> std::ws).eof()) {
+			throw Error() << "unexpected arguments";
+		}
+	}
+
+	size_t disassemble(std::ostringstream &os, uint32_t from, uint32_t to) {
+		Region *reg = anal.regions.regionContaining(from);
+		if (NULL == reg) {
+			reg = anal.regions.nextRegion(Region(from, 0, UNKNOWN));
+		}
+		for (; NULL != reg && reg->get_address() < to; reg = anal.regions.nextRegion(*reg)) {
+			print_region_part<AttSyntax>(os, *reg, from, to, lx, image, anal);
+		}
+		const std::string &text = os.str();
+		return std::count(text.begin(), text.end(), '\n');
+	}
+
+	/* Reads what is available and answers complete lines, false when the connection is done */
+	bool receive(int fd, std::string &pending) {
+		char buffer[4096];
+		ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+		if (size <= 0) {
+			return false;
+		}
+		pending.append(buffer, size);
+		for (size_t eol; (eol = pending.find('\n')) != std::string::npos; ) {
+			std::string reply;
+			bool open = query(pending.substr(0, eol), reply);
+			pending.erase(0, eol + 1);
+			if (!open || !sendAll(fd, reply)) {
+				return false;
+			}
+		}
+		if (pending.size() > MAX_LINE) {
+			sendAll(fd, "error line too long\n");
+			return false;
+		}
+		return true;
+	}
+
+	static bool sendAll(int fd, const std::string &data) {
+		for (size_t sent = 0; sent < data.size(); ) {
+			ssize_t size = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if (size <= 0) {
+				return false;
+			}
+			sent += size;
+		}
+		return true;
+	}
+};
+
+#endif /* SRC_SERVER_H_ */
@@ -0,0 +1,34 @@
+#ifndef SRC_SLICE_H_
+#define SRC_SLICE_H_
+
+#include <stdint.h>
+#include <climits>
+#include <vector>
+
+/* Restricts analysis and output to roots, an address range and a call depth, see --from/--to/--function/--depth */
+struct Slice {
+	uint32_t from;
+	uint32_t to;	// exclusive
+	std::vector<uint32_t> functions;
+	unsigned max_depth;	// calls followed from a root
+
+	Slice(void) : from(0), to(UINT32_MAX), max_depth(UINT_MAX) {}
+
+	bool enabled(void) const {
+		return hasRange() || !functions.empty();
+	}
+
+	bool hasRange(void) const {
+		return from > 0 || to < UINT32_MAX;
+	}
+
+	bool contains(uint32_t address) const {
+		return from <= address && address < to;
+	}
+
+	bool overlaps(uint32_t address, uint32_t end) const {
+		return address < to && from < end;
+	}
+};
+
+#endif /* SRC_SLICE_H_ */
@@ -0,0 +1,148 @@
+#ifndef SRC_STATS_H_
+#define SRC_STATS_H_
+
+#include <stdint.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "flags_restorer.h"
+
+/* Per-phase wall/CPU time, peak RSS and work counters, enabled by --stats */
+struct Stats {
+	struct Counters {
+		uint64_t instructions;	// decoded by DisInfo
+		uint64_t splits;
+		uint64_t merges;
+		uint64_t queue_pushes;
+		uint64_t labels;	// total at the end of phase
+		uint64_t fixups;	// total at the end of phase
+		uint64_t allocations;	// served by the analysis Arena
+
+		Counters(void) : instructions(0), splits(0), merges(0), queue_pushes(0), labels(0), fixups(0), allocations(0) {}
+	};
+
+	struct Phase {
+		std::string name;
+		double wall;
+		double cpu;
+		long peak_rss_kb;
+		Counters counters;
+	};
+
+	std::vector<Phase> phases;
+
+	Stats(void) : open(false), wall_start(0), cpu_start(0) {}
+
+	void begin(const char *name, const Counters &now) {
+		end(now);
+		Phase phase;
+		phase.name = name;
+		phases.push_back(phase);
+		start = now;
+		wall_start = seconds(CLOCK_MONOTONIC);
+		cpu_start = seconds(CLOCK_PROCESS_CPUTIME_ID);
+		open = true;
+	}
+
+	void end(const Counters &now) {
+		if (!open) {
+			return;
+		}
+		Phase &phase = phases.back();
+		phase.wall = seconds(CLOCK_MONOTONIC) - wall_start;
+		phase.cpu = seconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+		struct rusage usage;
+		phase.peak_rss_kb = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+		phase.counters.instructions = now.instructions - start.instructions;
+		phase.counters.splits = now.splits - start.splits;
+		phase.counters.merges = now.merges - start.merges;
+		phase.counters.queue_pushes = now.queue_pushes - start.queue_pushes;
+		phase.counters.labels = now.labels;
+		phase.counters.fixups = now.fixups;
+		phase.counters.allocations = now.allocations - start.allocations;
+		open = false;
+	}
+
+	std::ostream &printTable(std::ostream &os) const {
+		FlagsRestorer _(os);
+		os << std::left << std::setw(16) << "phase" << std::right
+				<< std::setw(10) << "wall[s]" << std::setw(10) << "cpu[s]" << std::setw(11) << "rss[KiB]"
+				<< std::setw(12) << "insns" << std::setw(9) << "splits" << std::setw(9) << "merges"
+				<< std::setw(9) << "pushes" << std::setw(9) << "labels" << std::setw(9) << "fixups" << std::setw(10) << "allocs" << std::endl;
+		for (size_t n = 0; n < phases.size(); ++n) {
+			const Phase &phase = phases[n];
+			os << std::left << std::setw(16) << phase.name << std::right << std::fixed << std::setprecision(4)
+					<< std::setw(10) << phase.wall << std::setw(10) << phase.cpu << std::setw(11) << std::dec << phase.peak_rss_kb
+					<< std::setw(12) << phase.counters.instructions << std::setw(9) << phase.counters.splits
+					<< std::setw(9) << phase.counters.merges << std::setw(9) << phase.counters.queue_pushes
+					<< std::setw(9) << phase.counters.labels << std::setw(9) << phase.counters.fixups << std::setw(10) << phase.counters.allocations << std::endl;
+		}
+		return os;
+	}
+
+	/* Reports the first phase whose peak RSS exceeded budget_kb, false then */
+	bool checkBudget(std::ostream &os, long budget_kb) const {
+		for (size_t n = 0; n < phases.size(); ++n) {
+			if (phases[n].peak_rss_kb > budget_kb) {
+				FlagsRestorer _(os);
+				os << std::dec << "Memory budget of " << budget_kb / 1024 << " MiB exceeded in phase " << phases[n].name
+						<< ": peak RSS " << phases[n].peak_rss_kb / 1024 << " MiB" << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::ostream &printJson(std::ostream &os, const char *input) const {
+		FlagsRestorer _(os);
+		printString(os << "{\"input\": ", input) << ", \"phases\": [";
+		for (size_t n = 0; n < phases.size(); ++n) {
+			const Phase &phase = phases[n];
+			printString(os << (n > 0 ? ", " : "") << "{\"name\": ", phase.name.c_str()) << ", "
+					<< std::fixed << std::setprecision(6) << "\"wall\": " << phase.wall << ", \"cpu\": " << phase.cpu
+					<< std::dec << ", \"peak_rss_kb\": " << phase.peak_rss_kb
+					<< ", \"instructions\": " << phase.counters.instructions << ", \"splits\": " << phase.counters.splits
+					<< ", \"merges\": " << phase.counters.merges << ", \"queue_pushes\": " << phase.counters.queue_pushes
+					<< ", \"labels\": " << phase.counters.labels << ", \"fixups\": " << phase.counters.fixups
+					<< ", \"allocations\": " << phase.counters.allocations << "}";
+		}
+		return os << "]}" << std::endl;
+	}
+private:
+	/* Quoted JSON string, escaped like print_escaped_string escapes data */
+	static std::ostream &printString(std::ostream &os, const char *str) {
+		os << '"';
+		for (; '\0' != *str; ++str) {
+			if (*str == '\t')
+				os << "\\t";
+			else if (*str == '\r')
+				os << "\\r";
+			else if (*str == '\n')
+				os << "\\n";
+			else if (*str == '\\' || *str == '"')
+				os << '\\' << *str;
+			else if ((uint8_t) *str < 0x20)
+				os << "\\u00" << std::hex << std::setfill('0') << std::setw(2) << (int) *str << std::dec;
+			else
+				os << *str;
+		}
+		return os << '"';
+	}
+
+	static double seconds(clockid_t clock) {
+		struct timespec ts;
+		clock_gettime(clock, &ts);
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+	}
+
+	bool open;
+	Counters start;
+	double wall_start;
+	double cpu_start;
+};
+
+#endif /* SRC_STATS_H_ */
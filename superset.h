@@ -0,0 +1,140 @@
+#ifndef SRC_SUPERSET_H_
+#define SRC_SUPERSET_H_
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+
+#include "dis_info.h"
+#include "le/fixup_index.h"
+#include "regions.h"
+
+/* Superset disassembly of a region tracing never reached: an instruction decoded at every byte offset
+ * into flat arrays, then every chain scored in two backward passes, so a region costs linear time.
+ *
+ * A chain starts at an offset and follows instruction lengths until a ret or jmp. It is plausible if all
+ * its instructions are and it ends so. Its direct branches must land on known code or on plausible chains,
+ * which for backward branches, scored after the branch in the backward pass, is only a chain ending so.
+ */
+class SupersetRegion {
+	enum {
+		BRANCH_SCORE = 2,	// per branch landing on a plausible chain or a code label
+		FIXUP_TARGET_SCORE = 4,
+		AFTER_CODE_SCORE = 1,	// chain at the region start, right after traced code
+		THRESHOLD = 4
+	};
+
+	uint32_t address;
+	bool after_code;
+	const AddressSet *fixup_targets;
+	std::vector<uint8_t> lengths;	// 0 for implausible instructions
+	std::vector<uint8_t> kinds;	// Insn::Type
+	std::vector<uint32_t> targets;	// of direct branches, 0 for none
+	std::vector<uint32_t> ends;	// offset after the ret or jmp ending the chain, 0 for none
+	std::vector<int32_t> scores;	// of branches along the chain, -1 for implausible chains
+
+	static bool implausible(const Insn &inst) {
+		static const char *texts[] = {"(bad)", "ss", "gs", "int3"};	// the first three as tracing treats them, int3 is padding
+		for (size_t n = 0; n < sizeof(texts)/sizeof(texts[0]); ++n) {
+			if (strstr(inst.text, texts[n]) == inst.text) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* 1 if the branch at offset lands on a plausible chain or a code label, -1 if on nothing plausible */
+	int branchScore(size_t offset, Regions &regions) const {
+		uint32_t target = targets[offset];
+		if (0 == target) {
+			return 0;
+		} else if (target - address < lengths.size()) {
+			size_t at = target - address;
+			return (at > offset ? scores[at] >= 0 : ends[at] != 0) ? 1 : -1;
+		}
+		const Region *reg = regions.regionContaining(target);
+		if (NULL == reg || DATA == reg->get_type()) {
+			return -1;
+		} else if (CODE == reg->get_type()) {
+			return regions.labelTypes.find(target) != regions.labelTypes.end() ? 1 : 0;
+		}
+		return 0;
+	}
+public:
+	SupersetRegion(void) : address(0), after_code(false), fixup_targets(NULL) {}
+
+	void decode(DisInfo &disasm, uint32_t address_, const uint8_t *data, size_t size) {
+		address = address_;
+		lengths.assign(size, 0);
+		kinds.assign(size, Insn::MISC);
+		targets.assign(size, 0);
+		Insn inst;
+		for (size_t off = 0; off < size; ++off) {
+			try {
+				disasm.disassemble(address + off, data + off, size - off, inst, DecodeProfile::SUPERSET);
+			} catch (const std::exception &) {
+				continue;
+			}
+			if (0 == inst.size || off + inst.size > size || implausible(inst)) {
+				continue;
+			}
+			lengths[off] = inst.size;
+			kinds[off] = inst.type;
+			if (Insn::MISC != inst.type && Insn::RET != inst.type && strchr(inst.text, '*') == NULL) {
+				targets[off] = inst.memoryAddress;
+			}
+		}
+	}
+
+	void score(Regions &regions, const AddressSet &fixupTargets, bool afterCode) {
+		size_t size = lengths.size();
+		fixup_targets = &fixupTargets;
+		after_code = afterCode;
+		ends.assign(size, 0);
+		scores.assign(size, -1);
+		for (size_t off = size; off-- > 0; ) {
+			size_t next = off + lengths[off];
+			if (0 == lengths[off]) {
+				continue;
+			} else if (Insn::RET == kinds[off] || Insn::JUMP == kinds[off]) {
+				ends[off] = next;
+			} else if (next < size) {
+				ends[off] = ends[next];
+			}
+		}
+		for (size_t off = size; off-- > 0; ) {	// needs ends of branch targets before and after off
+			if (0 == ends[off]) {
+				continue;
+			}
+			int branch = branchScore(off, regions);
+			int32_t rest = (Insn::RET == kinds[off] || Insn::JUMP == kinds[off]) ? 0 : scores[off + lengths[off]];
+			scores[off] = (branch < 0 || rest < 0) ? -1 : rest + branch * BRANCH_SCORE;
+		}
+	}
+
+	size_t size(void) const {
+		return lengths.size();
+	}
+
+	/* Whether the chain at offset is likely code, see THRESHOLD */
+	bool promotable(size_t offset) const {
+		if (scores[offset] < 0) {
+			return false;
+		}
+		int32_t confidence = scores[offset];
+		if (fixup_targets->find(address + offset) != fixup_targets->end()) {
+			confidence += FIXUP_TARGET_SCORE;
+		}
+		if (0 == offset && after_code) {
+			confidence += AFTER_CODE_SCORE;
+		}
+		return confidence >= THRESHOLD;
+	}
+
+	/* Offset after the chain at offset */
+	size_t chainEnd(size_t offset) const {
+		return ends[offset];
+	}
+};
+
+#endif /* SRC_SUPERSET_H_ */
@@ -0,0 +1,284 @@
+#ifndef SRC_SYNTAX_H_
+#define SRC_SYNTAX_H_
+
+#include <strings.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include "dis_info.h"
+#include "type.h"
+
+/* Output dialects, the template parameter of print_code so that the one printed in pays nothing for the
+ * others. Each decodes with the libopcodes printer of its operand order and spells directives, comments
+ * and the fixes of what libopcodes prints but its assembler would not take.
+ */
+struct AttSyntax {
+	enum {
+		QUOTE = '"'
+	};
+
+	static int decode(bfd_vma pc, disassemble_info *info) {
+		return print_insn_i386_att(pc, info);
+	}
+
+	static const char *bits(void) {
+		return ".code32";
+	}
+
+	static const char *section(Type type) {
+		return DATA == type ? ".data" : ".text";
+	}
+
+	static const char *global(void) {
+		return ".globl ";
+	}
+
+	static const char *commentStart(void) {
+		return "/* ";
+	}
+
+	static const char *commentLine(void) {
+		return " *";
+	}
+
+	static const char *commentEnd(void) {
+		return " */";
+	}
+
+	static const char *dword(void) {
+		return "\t\t.long   ";
+	}
+
+	static std::ostream &fill(std::ostream &os, size_t size) {
+		return os << "\t\t.fill   0x" << std::hex << size;
+	}
+
+	static const char *bytes(void) {
+		return "\t\t.ascii  \"";
+	}
+
+	static const char *string(bool zeroTerminated) {
+		return zeroTerminated ? "\t\t.string \"" : "\t\t.ascii   \"";
+	}
+
+	static const char *stringEnd(bool) {
+		return "\"\n";
+	}
+
+	/* False for instructions to print as ignored comments */
+	static bool fix(std::string &str) {
+		if (str.find("(287 only)") != std::string::npos) {
+			return false;
+		}
+		/* Work around buggy libopcodes */
+		if (str == "lar    %cx,%ecx") {
+			str = "lar    %ecx,%ecx";
+		} else if (str == "lsl    %ax,%eax") {
+			str = "lsl    %eax,%eax";
+		} else if (str == "lea    0x000000(%eax,%eiz,1),%eax") {
+			str = "lea    0x000000(%eax),%eax";
+		} else if (str == "lea    0x000000(%edx,%eiz,1),%edx") {
+			str = "lea    0x000000(%edx),%edx";	// https://www.technovelty.org/arch/the-quickest-way-to-do-nothing.html
+		}
+		return true;
+	}
+
+	/* Whether str prefixes the next instruction on the same line */
+	static bool prefix(const std::string &str) {
+		return str == "data16" or str == "data32";
+	}
+};
+
+/* NASM, from what libopcodes prints in Intel syntax */
+struct NasmSyntax {
+	enum {
+		QUOTE = '`'	// C escapes like \x00 only work in backquoted strings
+	};
+
+	static int decode(bfd_vma pc, disassemble_info *info) {
+		return print_insn_i386_intel(pc, info);
+	}
+
+	static const char *bits(void) {
+		return "bits 32";
+	}
+
+	static const char *section(Type type) {
+		return DATA == type ? "section .data" : "section .text";
+	}
+
+	static const char *global(void) {
+		return "global ";
+	}
+
+	static const char *commentStart(void) {
+		return "; ";
+	}
+
+	static const char *commentLine(void) {
+		return ";";
+	}
+
+	static const char *commentEnd(void) {
+		return "";
+	}
+
+	static const char *dword(void) {
+		return "\t\tdd      ";
+	}
+
+	static std::ostream &fill(std::ostream &os, size_t size) {
+		return os << "\t\ttimes 0x" << std::hex << size << " db 0";
+	}
+
+	static const char *bytes(void) {
+		return "\t\tdb      `";
+	}
+
+	static const char *string(bool) {
+		return "\t\tdb      `";
+	}
+
+	static const char *stringEnd(bool zeroTerminated) {
+		return zeroTerminated ? "`, 0\n" : "`\n";
+	}
+
+	/* False for instructions to print as ignored comments. Names operand sizes, segments and x87 registers
+	 * as NASM does and string instructions by their size suffix. libopcodes prints sizes as "DWORD PTR", Insn
+	 * lowercases them, so either case matches.
+	 */
+	static bool fix(std::string &str) {
+		if (find(str, "(287 only)") != std::string::npos) {
+			return false;
+		}
+		static const char *prefixes[][2] = {{"data16", "o16"}, {"data32", "o32"}, {"addr16", "a16"}, {"addr32", "a32"}};
+		for (size_t n = 0; n < sizeof(prefixes)/sizeof(prefixes[0]); ++n) {
+			if (strcasecmp(str.c_str(), prefixes[n][0]) == 0) {
+				str = prefixes[n][1];
+				return true;
+			}
+		}
+		size_t operands;
+		std::string mnemonic = mnemonicOf(str, operands);
+		if (stringInstruction(mnemonic)) {
+			const char *suffix = find(str, "dword ptr", operands) != std::string::npos ? "d"
+					: find(str, "word ptr", operands) != std::string::npos ? "w" : find(str, "byte ptr", operands) != std::string::npos ? "b" : "";
+			if ('\0' != *suffix) {
+				str = str.substr(0, str.find_last_not_of(' ', operands - 1) + 1) + suffix;
+				return true;
+			}
+		}
+		for (size_t n; (n = find(str, " ptr ", operands)) != std::string::npos; ) {
+			size_t word = str.find_last_of(" ,", n - 1) + 1;
+			std::string size = lower(str.substr(word, n - word));
+			if (size == "tbyte") {
+				size = "tword ";
+			} else if (size == "xmmword") {
+				size = "oword ";
+			} else if (size == "fword") {
+				size = mnemonic == "jmp" || mnemonic == "call" ? "far " : "";
+			} else {
+				size += " ";
+			}
+			str.replace(word, n + strlen(" ptr ") - word, size);
+		}
+		for (size_t n = operands; n < str.size(); n = str.find(',', n) + 1) {
+			n = str.find_first_not_of(' ', n);
+			for (; n < str.size() && isSize(str, n); n = str.find(' ', n) + 1);
+			if (n >= str.size()) {
+				break;
+			}
+			fixOperand(str, n);
+			if (str.find(',', n) == std::string::npos) {
+				break;
+			}
+		}
+		eraseAll(str, "+eiz*1");
+		eraseAll(str, "eiz*1+");
+		return true;
+	}
+
+	static bool prefix(const std::string &str) {
+		return str == "o16" or str == "o32" or str == "a16" or str == "a32";
+	}
+private:
+	static std::string lower(std::string str) {
+		for (size_t n = 0; n < str.size(); str[n] = tolower(str[n]), ++n);
+		return str;
+	}
+
+	/* Whether str holds what at the position, in either case */
+	static bool matches(const std::string &str, size_t at, const char *what) {
+		return at <= str.size() && strncasecmp(str.c_str() + at, what, strlen(what)) == 0;
+	}
+
+	static size_t find(const std::string &str, const char *what, size_t from = 0) {
+		for (; from < str.size(); ++from) {
+			if (matches(str, from, what)) {
+				return from;
+			}
+		}
+		return std::string::npos;
+	}
+
+	/* Lowercased mnemonic after any prefixes, operands set to where they start */
+	static std::string mnemonicOf(const std::string &str, size_t &operands) {
+		static const char *prefixes[] = {"rep", "repz", "repnz", "repe", "repne", "lock", "data16", "data32", "addr16", "addr32"};
+		size_t start = 0;
+		for (;;) {
+			size_t end = std::min(str.find(' ', start), str.size());
+			std::string word = lower(str.substr(start, end - start));
+			operands = std::min(str.find_first_not_of(' ', end), str.size());
+			if (operands == str.size() || std::find(prefixes, prefixes + sizeof(prefixes)/sizeof(prefixes[0]), word) == prefixes + sizeof(prefixes)/sizeof(prefixes[0])) {
+				return word;
+			}
+			start = operands;
+		}
+	}
+
+	static bool stringInstruction(const std::string &mnemonic) {
+		return mnemonic == "movs" || mnemonic == "stos" || mnemonic == "lods" || mnemonic == "scas" || mnemonic == "cmps"
+				|| mnemonic == "ins" || mnemonic == "outs";
+	}
+
+	static bool isSize(const std::string &str, size_t at) {
+		static const char *sizes[] = {"byte ", "word ", "dword ", "qword ", "tword ", "oword ", "far "};
+		for (size_t n = 0; n < sizeof(sizes)/sizeof(sizes[0]); ++n) {
+			if (matches(str, at, sizes[n])) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* Segment overrides go inside brackets, which absolute addresses get, and st(N) is stN */
+	static void fixOperand(std::string &str, size_t at) {
+		size_t end = std::min(str.find(',', at), str.size());
+		if (end - at >= 3 && str[at + 2] == ':' && tolower(str[at + 1]) == 's' && strchr("cdefgs", tolower(str[at])) != NULL) {
+			if ('[' == str[at + 3]) {
+				str.erase(at + 3, 1);
+				str.insert(at, "[");
+			} else {
+				str.insert(end, "]");
+				str.insert(at, "[");
+				if ('d' == tolower(str[at + 1])) {
+					str.erase(at + 1, 3);	// the default one
+				}
+			}
+		} else if (end - at == 2 && matches(str, at, "st")) {
+			str.insert(end, "0");
+		} else if (end - at == 5 && matches(str, at, "st(") && ')' == str[at + 4]) {
+			str.erase(at + 4, 1);
+			str.erase(at + 2, 1);
+		}
+	}
+
+	static void eraseAll(std::string &str, const char *what) {
+		for (size_t n; (n = find(str, what)) != std::string::npos; str.erase(n, strlen(what)));
+	}
+};
+
+#endif /* SRC_SYNTAX_H_ */
@@ -0,0 +1,155 @@
+#ifndef SRC_TRACE_GRAPH_H_
+#define SRC_TRACE_GRAPH_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "type.h"
+
+typedef std::vector<std::pair<uint32_t/*address*/, uint32_t/*end*/> > AddressRanges;
+
+/* Sorts ranges and merges the overlapping or adjacent ones */
+inline void mergeRanges(AddressRanges &ranges) {
+	std::sort(ranges.begin(), ranges.end());
+	AddressRanges merged;
+	for (size_t n = 0; n < ranges.size(); ++n) {
+		if (!merged.empty() && ranges[n].first <= merged.back().second) {
+			merged.back().second = std::max(merged.back().second, ranges[n].second);
+		} else {
+			merged.push_back(ranges[n]);
+		}
+	}
+	ranges.swap(merged);
+}
+
+/* Whether [address, end) overlaps one of the merged ranges */
+inline bool overlapsAny(const AddressRanges &ranges, uint32_t address, uint32_t end) {
+	AddressRanges::const_iterator itr = std::lower_bound(ranges.begin(), ranges.end(), std::make_pair(end, 0u));
+	return ranges.begin() != itr && address < (--itr)->second;
+}
+
+/* What every trace of an analysis did, recorded with --state so that Analyzer::reanalyze can undo the
+ * traces a hint change affects and those depending on them only, instead of analyzing everything again.
+ *
+ * A trace is a code region as traced from one address or a jump table. Its edges are the addresses it
+ * scheduled or marked as data. Guesses from relocs and superset chains have no edges, reanalyze guesses
+ * again in what it undid.
+ */
+struct TraceGraph {
+	enum {
+		NONE = 0	// source of addresses not scheduled by a trace
+	};
+
+	struct Trace {
+		uint32_t end;
+		uint8_t type;	// CODE, DATA for all nops or SWITCH
+		bool cut;	// ended at the next region instead of at a jump, which may move
+	};
+
+	struct Edge {
+		uint32_t source;	// trace start
+		uint32_t target;
+		uint8_t type;	// label type the target got
+
+		static bool sourceLess(const Edge &a, const Edge &b) {
+			return a.source < b.source;
+		}
+
+		static bool targetLess(const Edge &a, const Edge &b) {
+			return a.target < b.target;
+		}
+	};
+
+	std::map<uint32_t/*start*/, Trace> traces;
+	std::map<uint32_t/*address*/, uint32_t/*size*/> islands;	// FPU operands split out as data by traces
+	std::vector<uint32_t> displacements;	// addresses of the rel32 of traced branches, for Baseline hashes
+	std::vector<Edge> edges;	// by source up to sorted, then as recorded
+	std::vector<Edge> incoming;	// edges[0, sorted) by target, the latest last
+	size_t sorted;
+
+	TraceGraph(void) : sorted(0) {}
+
+	void addTrace(uint32_t start, uint32_t end, Type type, bool cut) {
+		Trace trace = {end, (uint8_t) type, cut};
+		traces[start] = trace;
+	}
+
+	void addEdge(uint32_t source, uint32_t target, Type type) {
+		Edge edge = {source, target, (uint8_t) type};
+		edges.push_back(edge);
+	}
+
+	/* Sorts the edges recorded since the last call into both orders, linear time for a few new ones */
+	void seal(void) {
+		if (sorted == edges.size()) {
+			return;
+		}
+		incoming.insert(incoming.end(), edges.begin() + sorted, edges.end());
+		std::stable_sort(incoming.begin() + sorted, incoming.end(), Edge::targetLess);
+		std::inplace_merge(incoming.begin(), incoming.begin() + sorted, incoming.end(), Edge::targetLess);
+		std::stable_sort(edges.begin() + sorted, edges.end(), Edge::sourceLess);
+		std::inplace_merge(edges.begin(), edges.begin() + sorted, edges.end(), Edge::sourceLess);
+		sorted = edges.size();
+	}
+
+	/* Drops the traces, their edges and displacements, leaves the graph sealed */
+	void remove(const std::set<uint32_t> &starts) {
+		seal();
+		AddressRanges extents;
+		for (std::set<uint32_t>::const_iterator itr = starts.begin(); itr != starts.end(); ++itr) {
+			std::map<uint32_t, Trace>::iterator trace = traces.find(*itr);
+			if (traces.end() != trace) {
+				extents.push_back(std::make_pair(*itr, trace->second.end));
+				traces.erase(trace);
+			}
+		}
+		mergeRanges(extents);
+		displacements.erase(std::remove_if(displacements.begin(), displacements.end(), Within(extents)), displacements.end());
+		edges.erase(std::remove_if(edges.begin(), edges.end(), SourceIn(starts)), edges.end());
+		incoming.erase(std::remove_if(incoming.begin(), incoming.end(), SourceIn(starts)), incoming.end());
+		sorted = edges.size();
+	}
+
+	std::pair<std::vector<Edge>::const_iterator, std::vector<Edge>::const_iterator> outgoing(uint32_t source) const {
+		Edge key = {source, 0, 0};
+		return std::equal_range(edges.begin(), edges.begin() + sorted, key, Edge::sourceLess);
+	}
+
+	/* Last edge to target from a trace not in dropped, NULL for none */
+	const Edge *liveEdge(uint32_t target, const std::set<uint32_t> &dropped) const {
+		Edge key = {0, target, 0};
+		std::vector<Edge>::const_iterator itr = std::upper_bound(incoming.begin(), incoming.end(), key, Edge::targetLess);
+		for (; incoming.begin() != itr && (--itr)->target == target; ) {
+			if (dropped.end() == dropped.find(itr->source)) {
+				return &*itr;
+			}
+		}
+		return NULL;
+	}
+private:
+	struct Within {
+		const AddressRanges &ranges;
+
+		Within(const AddressRanges &ranges_) : ranges(ranges_) {}
+
+		bool operator()(uint32_t address) const {
+			return overlapsAny(ranges, address, address + 1);
+		}
+	};
+
+	struct SourceIn {
+		const std::set<uint32_t> &starts;
+
+		SourceIn(const std::set<uint32_t> &starts_) : starts(starts_) {}
+
+		bool operator()(const Edge &edge) const {
+			return starts.end() != starts.find(edge.source);
+		}
+	};
+};
+
+#endif /* SRC_TRACE_GRAPH_H_ */
@@ -3,7 +3,7 @@
 
 #include "flags_restorer.h"
 
-std::ostream &printAddress(std::ostream &os, uint32_t address, const char *prefix = "0x") {
+inline std::ostream &printAddress(std::ostream &os, uint32_t address, const char *prefix = "0x") {
 	FlagsRestorer _(os);
 	return os << prefix << std::setfill('0') << std::setw(6) << std::hex << std::noshowbase << address;
 }